@@ -0,0 +1,256 @@
+#include "BpfEngine.hpp"
+
+#include <cstring>
+
+namespace OverTheWire::BpfFilter {
+
+static inline uint32_t loadWord(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+static inline uint32_t loadHalf(const uint8_t* p) {
+  return (uint32_t(p[0]) << 8) | p[1];
+}
+
+std::string BpfEngine::load(const std::vector<bpf_insn>& insns) {
+  ops.clear();
+  usesMem = false;
+  if (insns.empty()) {
+    return "Empty program";
+  }
+
+  std::vector<Op> res;
+  res.reserve(insns.size());
+  const uint32_t n = insns.size();
+  for (uint32_t i{}; i < n; ++i) {
+    const bpf_insn& insn = insns[i];
+    Op op{ret_k, insn.k, 0, 0};
+    bool known = true;
+    switch (BPF_CLASS(insn.code)) {
+      case BPF_RET:
+        if (BPF_RVAL(insn.code) == BPF_K) op.code = ret_k;
+        else if (BPF_RVAL(insn.code) == BPF_A) op.code = ret_a;
+        else known = false;
+        break;
+      case BPF_LD:
+        switch (insn.code) {
+          case BPF_LD|BPF_W|BPF_ABS: op.code = ld_w_abs; break;
+          case BPF_LD|BPF_H|BPF_ABS: op.code = ld_h_abs; break;
+          case BPF_LD|BPF_B|BPF_ABS: op.code = ld_b_abs; break;
+          case BPF_LD|BPF_W|BPF_IND: op.code = ld_w_ind; break;
+          case BPF_LD|BPF_H|BPF_IND: op.code = ld_h_ind; break;
+          case BPF_LD|BPF_B|BPF_IND: op.code = ld_b_ind; break;
+          case BPF_LD|BPF_W|BPF_LEN: op.code = ld_len; break;
+          case BPF_LD|BPF_IMM: op.code = ld_imm; break;
+          case BPF_LD|BPF_MEM: op.code = ld_mem; usesMem = true; break;
+          default: known = false;
+        }
+        break;
+      case BPF_LDX:
+        switch (insn.code) {
+          case BPF_LDX|BPF_W|BPF_IMM: op.code = ldx_imm; break;
+          case BPF_LDX|BPF_W|BPF_MEM: op.code = ldx_mem; usesMem = true; break;
+          case BPF_LDX|BPF_W|BPF_LEN: op.code = ldx_len; break;
+          case BPF_LDX|BPF_B|BPF_MSH: op.code = ldx_msh; break;
+          default: known = false;
+        }
+        break;
+      case BPF_ST: op.code = st; usesMem = true; break;
+      case BPF_STX: op.code = stx; usesMem = true; break;
+      case BPF_ALU: {
+        bool x = BPF_SRC(insn.code) == BPF_X;
+        switch (BPF_OP(insn.code)) {
+          case BPF_ADD: op.code = x ? add_x : add_k; break;
+          case BPF_SUB: op.code = x ? sub_x : sub_k; break;
+          case BPF_MUL: op.code = x ? mul_x : mul_k; break;
+          case BPF_DIV: op.code = x ? div_x : div_k; break;
+          case BPF_MOD: op.code = x ? mod_x : mod_k; break;
+          case BPF_AND: op.code = x ? and_x : and_k; break;
+          case BPF_OR: op.code = x ? or_x : or_k; break;
+          case BPF_XOR: op.code = x ? xor_x : xor_k; break;
+          case BPF_LSH: op.code = x ? lsh_x : lsh_k; break;
+          case BPF_RSH: op.code = x ? rsh_x : rsh_k; break;
+          case BPF_NEG: op.code = neg; break;
+          default: known = false;
+        }
+        if (!x && (op.code == div_k || op.code == mod_k) && insn.k == 0) {
+          return "Division by zero at " + std::to_string(i);
+        }
+        break;
+      }
+      case BPF_JMP: {
+        bool x = BPF_SRC(insn.code) == BPF_X;
+        if (BPF_OP(insn.code) == BPF_JA) {
+          op.code = ja;
+          op.jt = op.jf = i + 1 + insn.k;
+          if (insn.k >= n || op.jt >= n) {
+            return "Jump out of the program at " + std::to_string(i);
+          }
+          break;
+        }
+        switch (BPF_OP(insn.code)) {
+          case BPF_JEQ: op.code = x ? jeq_x : jeq_k; break;
+          case BPF_JGT: op.code = x ? jgt_x : jgt_k; break;
+          case BPF_JGE: op.code = x ? jge_x : jge_k; break;
+          case BPF_JSET: op.code = x ? jset_x : jset_k; break;
+          default: known = false;
+        }
+        op.jt = i + 1 + insn.jt;
+        op.jf = i + 1 + insn.jf;
+        if (op.jt >= n || op.jf >= n) {
+          return "Jump out of the program at " + std::to_string(i);
+        }
+        break;
+      }
+      case BPF_MISC:
+        if (BPF_MISCOP(insn.code) == BPF_TAX) op.code = tax;
+        else if (BPF_MISCOP(insn.code) == BPF_TXA) op.code = txa;
+        else known = false;
+        break;
+      default:
+        known = false;
+    }
+    if (!known) {
+      return "Unsupported instruction " + std::to_string(insn.code) + " at " + std::to_string(i);
+    }
+    if ((op.code == ld_mem || op.code == ldx_mem || op.code == st || op.code == stx) && insn.k >= BPF_MEMWORDS) {
+      return "Scratch memory index out of range at " + std::to_string(i);
+    }
+    res.push_back(op);
+  }
+
+  // falling off the end is not an option
+  if (res.back().code != ret_k && res.back().code != ret_a) {
+    return "The program doesn't end with a return";
+  }
+
+  ops = std::move(res);
+  return "";
+}
+
+uint32_t BpfEngine::run(const uint8_t* p, uint32_t wirelen, uint32_t buflen, uint32_t start, uint32_t acc) const {
+  uint32_t A = acc;
+  uint32_t X = 0;
+  uint32_t k;
+  uint32_t mem[BPF_MEMWORDS];
+  if (usesMem) {
+    memset(mem, 0, sizeof(mem));
+  }
+
+  const Op* base = ops.data();
+  const Op* pc = base + start;
+
+#if OTW_BPF_THREADED
+#define OTW_BPF_LABEL(name) &&op_##name,
+  static const void* labels[] = { OTW_BPF_OPS(OTW_BPF_LABEL) };
+#undef OTW_BPF_LABEL
+#define OP(name) op_##name:
+#define NEXT() do { ++pc; goto *labels[pc->code]; } while (0)
+#define JUMP(target) do { pc = base + (target); goto *labels[pc->code]; } while (0)
+  goto *labels[pc->code];
+#else
+#define OP(name) case name:
+#define NEXT() do { ++pc; goto dispatch; } while (0)
+#define JUMP(target) do { pc = base + (target); goto dispatch; } while (0)
+dispatch:
+  switch (pc->code) {
+#endif
+
+  OP(ret_k) return pc->k;
+  OP(ret_a) return A;
+
+  OP(ld_w_abs)
+    k = pc->k;
+    if (k > buflen || sizeof(uint32_t) > buflen - k) return 0;
+    A = loadWord(p + k);
+    NEXT();
+  OP(ld_h_abs)
+    k = pc->k;
+    if (k > buflen || sizeof(uint16_t) > buflen - k) return 0;
+    A = loadHalf(p + k);
+    NEXT();
+  OP(ld_b_abs)
+    k = pc->k;
+    if (k >= buflen) return 0;
+    A = p[k];
+    NEXT();
+
+  OP(ld_w_ind)
+    k = pc->k;
+    if (k > buflen || X > buflen - k || sizeof(uint32_t) > buflen - k - X) return 0;
+    A = loadWord(p + k + X);
+    NEXT();
+  OP(ld_h_ind)
+    k = pc->k;
+    if (k > buflen || X > buflen - k || sizeof(uint16_t) > buflen - k - X) return 0;
+    A = loadHalf(p + k + X);
+    NEXT();
+  OP(ld_b_ind)
+    k = pc->k;
+    if (k >= buflen || X >= buflen - k) return 0;
+    A = p[k + X];
+    NEXT();
+
+  OP(ld_len) A = wirelen; NEXT();
+  OP(ld_imm) A = pc->k; NEXT();
+  OP(ld_mem) A = mem[pc->k]; NEXT();
+  OP(ldx_imm) X = pc->k; NEXT();
+  OP(ldx_mem) X = mem[pc->k]; NEXT();
+  OP(ldx_len) X = wirelen; NEXT();
+  OP(ldx_msh)
+    k = pc->k;
+    if (k >= buflen) return 0;
+    X = (p[k] & 0xf) << 2;
+    NEXT();
+
+  OP(st) mem[pc->k] = A; NEXT();
+  OP(stx) mem[pc->k] = X; NEXT();
+
+  OP(add_k) A += pc->k; NEXT();
+  OP(sub_k) A -= pc->k; NEXT();
+  OP(mul_k) A *= pc->k; NEXT();
+  OP(div_k) A /= pc->k; NEXT();
+  OP(mod_k) A %= pc->k; NEXT();
+  OP(and_k) A &= pc->k; NEXT();
+  OP(or_k) A |= pc->k; NEXT();
+  OP(xor_k) A ^= pc->k; NEXT();
+  OP(lsh_k) A = pc->k < 32 ? A << pc->k : 0; NEXT();
+  OP(rsh_k) A = pc->k < 32 ? A >> pc->k : 0; NEXT();
+
+  OP(add_x) A += X; NEXT();
+  OP(sub_x) A -= X; NEXT();
+  OP(mul_x) A *= X; NEXT();
+  OP(div_x) if (X == 0) return 0; A /= X; NEXT();
+  OP(mod_x) if (X == 0) return 0; A %= X; NEXT();
+  OP(and_x) A &= X; NEXT();
+  OP(or_x) A |= X; NEXT();
+  OP(xor_x) A ^= X; NEXT();
+  OP(lsh_x) A = X < 32 ? A << X : 0; NEXT();
+  OP(rsh_x) A = X < 32 ? A >> X : 0; NEXT();
+
+  OP(neg) A = -A; NEXT();
+
+  OP(ja) JUMP(pc->jt);
+  OP(jeq_k) JUMP(A == pc->k ? pc->jt : pc->jf);
+  OP(jgt_k) JUMP(A > pc->k ? pc->jt : pc->jf);
+  OP(jge_k) JUMP(A >= pc->k ? pc->jt : pc->jf);
+  OP(jset_k) JUMP(A & pc->k ? pc->jt : pc->jf);
+  OP(jeq_x) JUMP(A == X ? pc->jt : pc->jf);
+  OP(jgt_x) JUMP(A > X ? pc->jt : pc->jf);
+  OP(jge_x) JUMP(A >= X ? pc->jt : pc->jf);
+  OP(jset_x) JUMP(A & X ? pc->jt : pc->jf);
+
+  OP(tax) X = A; NEXT();
+  OP(txa) A = X; NEXT();
+
+#if !OTW_BPF_THREADED
+  }
+  return 0;
+#endif
+
+#undef OP
+#undef NEXT
+#undef JUMP
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pcap.h"
+
+/* Classic BPF interpreter for userspace matching.
+ * load() decodes the program once: every instruction gets its own opcode
+ * (a load of a word at an absolute offset, a jump if equal to a constant...)
+ * with its jump targets made absolute, so run() does no decoding.
+ * With GCC and Clang the opcodes dispatch through computed gotos (threaded
+ * code), otherwise through a switch. Out of bounds loads and division by
+ * zero end the program with 0, like libpcap's bpf_filter().
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OTW_BPF_THREADED 1
+#else
+#define OTW_BPF_THREADED 0
+#endif
+
+namespace OverTheWire::BpfFilter {
+
+#define OTW_BPF_OPS(X) \
+  X(ret_k) X(ret_a) \
+  X(ld_w_abs) X(ld_h_abs) X(ld_b_abs) \
+  X(ld_w_ind) X(ld_h_ind) X(ld_b_ind) \
+  X(ld_len) X(ld_imm) X(ld_mem) \
+  X(ldx_imm) X(ldx_mem) X(ldx_len) X(ldx_msh) \
+  X(st) X(stx) \
+  X(add_k) X(sub_k) X(mul_k) X(div_k) X(mod_k) X(and_k) X(or_k) X(xor_k) X(lsh_k) X(rsh_k) \
+  X(add_x) X(sub_x) X(mul_x) X(div_x) X(mod_x) X(and_x) X(or_x) X(xor_x) X(lsh_x) X(rsh_x) \
+  X(neg) \
+  X(ja) X(jeq_k) X(jgt_k) X(jge_k) X(jset_k) X(jeq_x) X(jgt_x) X(jge_x) X(jset_x) \
+  X(tax) X(txa)
+
+  struct BpfEngine {
+#define OTW_BPF_ENUM(name) name,
+    enum Opcode : uint8_t { OTW_BPF_OPS(OTW_BPF_ENUM) };
+#undef OTW_BPF_ENUM
+
+    struct Op {
+      Opcode code;
+      uint32_t k;
+      uint32_t jt;
+      uint32_t jf;
+    };
+
+    // fails on instructions it doesn't know, the caller falls back to bpf_filter()
+    std::string load(const std::vector<bpf_insn>&);
+    // start and acc resume a program whose first instructions were run elsewhere
+    uint32_t run(const uint8_t* pkt, uint32_t wirelen, uint32_t buflen, uint32_t start = 0, uint32_t acc = 0) const;
+    bool loaded() const { return !ops.empty(); }
+    void clear() { ops.clear(); }
+
+    std::vector<Op> ops;
+    bool usesMem = false;
+  };
+
+}
@@ -1,17 +1,43 @@
 #include "BpfFilter.hpp"
+#include "FilterSet.hpp"
 
 namespace OverTheWire::BpfFilter {
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   BpfFilter::Init(env, exports);
+  FilterSet::Init(env, exports);
   return exports;
 }
 
+std::string compile(const std::string& expr, int linkType, program_t& res, int snaplen) {
+  pcap_t* handle = pcap_open_dead(linkType, snaplen);
+  if (!handle) {
+    return "Could not open a pcap handle for link type " + std::to_string(linkType);
+  }
+  bpf_program prog;
+  if (pcap_compile(handle, &prog, expr.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0) {
+    std::string err = pcap_geterr(handle);
+    pcap_close(handle);
+    return err;
+  }
+  res.assign(prog.bf_insns, prog.bf_insns + prog.bf_len);
+  pcap_freecode(&prog);
+  pcap_close(handle);
+  return "";
+}
+
 Napi::Object BpfFilter::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(env, "BpfFilter", {
     InstanceMethod<&BpfFilter::match>("match", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&BpfFilter::matchMany>("matchMany", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceAccessor<&BpfFilter::getFilter, &BpfFilter::setFilter>("value"),
     InstanceAccessor<&BpfFilter::getLinkType, &BpfFilter::setLinkType>("linkType"),
+    InstanceAccessor<&BpfFilter::getBytecode, &BpfFilter::setBytecode>("bytecode"),
+    InstanceAccessor<&BpfFilter::getEngine, &BpfFilter::setEngine>("engine"),
+    StaticMethod<&BpfFilter::warm>("warm", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    StaticMethod<&BpfFilter::cacheStats>("cacheStats", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    StaticMethod<&BpfFilter::setCacheCapacity>("setCacheCapacity", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    StaticMethod<&BpfFilter::clearCache>("clearCache", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
   });
 
   env.GetInstanceData<AddonData>()->SetClass(typeid(BpfFilter), func);
@@ -20,17 +46,26 @@ Napi::Object BpfFilter::Init(Napi::Env env, Napi::Object exports) {
 }
 
 BpfFilter::BpfFilter(const Napi::CallbackInfo& info) : Napi::ObjectWrap<BpfFilter>{info}, obj{new pcpp::BpfFilterWrapper} {
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    linkType = static_cast<decltype(linkType)>(info[1].As<Napi::Number>().Uint32Value());
+  }
+  if (info.Length() > 2 && !info[2].IsUndefined()) {
+    snaplen = info[2].As<Napi::Number>().Int32Value();
+  }
+  if (info.Length() > 0 && info[0].IsBuffer()) {
+    auto err = loadBytecode(info[0]);
+    if (err.size() > 0) {
+      Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+    }
+    return;
+  }
   if (info.Length() > 0) {
     filter = info[0].As<Napi::String>().Utf8Value(); 
   }
-  if (info.Length() > 1) {
-    linkType = static_cast<decltype(linkType)>(info[1].As<Napi::Number>().Uint32Value());
-  }
 
-  if (filter.size() > 0) {
-    if (!obj->setFilter(filter, linkType)) {
-      Napi::Error::New(info.Env(), "Error setting filter").ThrowAsJavaScriptException();
-    }
+  auto err = loadFilter();
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), "Error setting filter: " + err).ThrowAsJavaScriptException();
   }
 }
 
@@ -46,24 +81,114 @@ Napi::Value BpfFilter::getLinkType(const Napi::CallbackInfo& info) {
 
 void BpfFilter::setFilter(const Napi::CallbackInfo& info, const Napi::Value& val) {
   filter = val.As<Napi::String>().Utf8Value();
+  fromBytecode = false;
+
+  auto err = loadFilter();
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), "Error setting filter: " + err).ThrowAsJavaScriptException();
+  }
+}
+
+// the program comes from the cache, the wrapper only gets the expression when it's needed
+std::string BpfFilter::loadFilter() {
+  std::string err;
+  program = filter.size() > 0 ? FilterCache::instance().get(filter, linkType, snaplen, err) : nullptr;
+  loadEngine();
+  return err;
+}
 
-  if (!obj->setFilter(filter, linkType)) {
-    Napi::Error::New(info.Env(), "Error setting filter").ThrowAsJavaScriptException();
+void BpfFilter::loadEngine() {
+  if (!program || engine.load(*program).size() > 0) {
+    engine.clear();
   }
 }
 
-void BpfFilter::setLinkType(const Napi::CallbackInfo&, const Napi::Value& val) {
+Napi::Value BpfFilter::getEngine(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(), useEngine && engine.loaded() ? "native" : "pcap");
+}
+
+void BpfFilter::setEngine(const Napi::CallbackInfo& info, const Napi::Value& val) {
+  std::string name = val.As<Napi::String>().Utf8Value();
+  if (name != "native" && name != "pcap") {
+    Napi::Error::New(info.Env(), "Unknown engine " + name).ThrowAsJavaScriptException();
+    return;
+  }
+  useEngine = name == "native";
+}
+
+Napi::Value BpfFilter::getBytecode(const Napi::CallbackInfo& info) {
+  if (!program) {
+    return js_buffer_t::New(info.Env(), 0);
+  }
+  // bpf_insn has the layout of the kernel's sock_filter
+  return js_buffer_t::Copy(info.Env(), (uint8_t*)program->data(), program->size() * sizeof(bpf_insn));
+}
+
+void BpfFilter::setBytecode(const Napi::CallbackInfo& info, const Napi::Value& val) {
+  auto err = loadBytecode(val);
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+  }
+}
+
+std::string BpfFilter::loadBytecode(const Napi::Value& val) {
+  if (!val.IsBuffer()) {
+    return "Expected a Buffer of bpf_insn";
+  }
+  js_buffer_t buf = val.As<js_buffer_t>();
+  size_t len = buf.Length() / sizeof(bpf_insn);
+  if (buf.Length() % sizeof(bpf_insn) != 0 || len == 0) {
+    return "The bytecode length is not a multiple of " + std::to_string(sizeof(bpf_insn));
+  }
+  auto insns = std::make_shared<program_t>(len);
+  memcpy(insns->data(), buf.Data(), buf.Length());
+  if (!bpf_validate(insns->data(), len)) {
+    return "Invalid BPF program";
+  }
+  program = std::move(insns);
+  fromBytecode = true;
+  filter = "";
+  loadEngine();
+  return "";
+}
+
+void BpfFilter::setLinkType(const Napi::CallbackInfo& info, const Napi::Value& val) {
   linkType = static_cast<decltype(linkType)>(val.As<Napi::Number>().Uint32Value());
+  if (fromBytecode) {
+    return;
+  }
+  // the offsets depend on the link type
+  auto err = loadFilter();
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), "Error setting filter: " + err).ThrowAsJavaScriptException();
+  }
 }
 
 Napi::Value BpfFilter::match(const Napi::CallbackInfo& info) {
   checkLength(info, 1);
 
-  if (filter.size() == 0) {
+  if (filter.size() == 0 && !fromBytecode) {
     return Napi::Boolean::New(info.Env(), true);
   }
 
   js_buffer_t buf = info[0].As<js_buffer_t>();
+  auto _linkType = linkType;
+  if (info.Length() > 3) {
+    _linkType = static_cast<decltype(linkType)>(info[2].As<Napi::Number>().Uint32Value());
+  }
+
+  // there's no expression to hand to the wrapper for bytecode, and the program
+  // doesn't look at the timestamp, so the wrapper is only needed for another link type
+  if (fromBytecode || _linkType == linkType) {
+    return Napi::Boolean::New(info.Env(), run(buf.Data(), buf.Length(), buf.Length()));
+  }
+  if (wrapperFilter != filter) {
+    if (!obj->setFilter(filter, linkType)) {
+      Napi::Error::New(info.Env(), "Error setting filter").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    wrapperFilter = filter;
+  }
   struct timespec ts;
   if (info.Length() > 1) {
     Napi::Array hrtime = info[1].As<Napi::Array>();
@@ -74,12 +199,107 @@ Napi::Value BpfFilter::match(const Napi::CallbackInfo& info) {
     timespec_get(&ts, TIME_UTC);
   }
 
-  auto _linkType = linkType;
-  if (info.Length() > 3) {
-    _linkType = static_cast<decltype(linkType)>(info[2].As<Napi::Number>().Uint32Value());
+  return Napi::Boolean::New(info.Env(), obj->matchPacketWithFilter(buf.Data(), buf.Length(), ts, _linkType));
+}
+
+bool BpfFilter::run(const uint8_t* data, size_t caplen, size_t wirelen) {
+  if (!program) {
+    return filter.size() == 0;
+  }
+  if (useEngine && engine.loaded()) {
+    return engine.run(data, wirelen, caplen) != 0;
   }
+  // what pcap_offline_filter does for the wrapper, minus the header
+  return bpf_filter(program->data(), data, wirelen, caplen) != 0;
+}
 
-  return Napi::Boolean::New(info.Env(), obj->matchPacketWithFilter(buf.Data(), buf.Length(), ts, _linkType));
+/* warm(expressions[], linkType?, snaplen?) compiles into the cache ahead of
+ * time, throws on the first expression that doesn't compile.
+ */
+Napi::Value BpfFilter::warm(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  checkLength(info, 1);
+  if (!info[0].IsArray()) {
+    Napi::TypeError::New(env, "Expected an array of filter expressions").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  int linkType = pcpp::LinkLayerType::LINKTYPE_ETHERNET;
+  int snaplen = defaultSnaplen;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    linkType = info[1].As<Napi::Number>().Int32Value();
+  }
+  if (info.Length() > 2 && !info[2].IsUndefined()) {
+    snaplen = info[2].As<Napi::Number>().Int32Value();
+  }
+
+  Napi::Array exprs = info[0].As<Napi::Array>();
+  for (uint32_t i{}; i < exprs.Length(); ++i) {
+    std::string expr = exprs.Get(i).As<Napi::String>().Utf8Value();
+    std::string err;
+    if (!FilterCache::instance().get(expr, linkType, snaplen, err)) {
+      Napi::Error::New(env, "Error compiling filter " + std::to_string(i) + " (" + expr + "): " + err).ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+  return env.Undefined();
+}
+
+Napi::Value BpfFilter::cacheStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  auto stats = FilterCache::instance().stats();
+  auto res = Napi::Object::New(env);
+  res.Set("hits", Napi::Number::New(env, stats.hits));
+  res.Set("misses", Napi::Number::New(env, stats.misses));
+  res.Set("size", Napi::Number::New(env, stats.size));
+  res.Set("capacity", Napi::Number::New(env, stats.capacity));
+  return res;
+}
+
+Napi::Value BpfFilter::setCacheCapacity(const Napi::CallbackInfo& info) {
+  checkLength(info, 1);
+  FilterCache::instance().setCapacity(info[0].As<Napi::Number>().Uint32Value());
+  return info.Env().Undefined();
+}
+
+Napi::Value BpfFilter::clearCache(const Napi::CallbackInfo& info) {
+  FilterCache::instance().clear();
+  return info.Env().Undefined();
+}
+
+/* matchMany(buffers[], options) or matchMany(buffer, table, options), see readPacketViews.
+ * Returns a bitmap (bit i of byte i / 8, lowest first) or, with
+ * options.indices, the indices of the matching packets.
+ */
+Napi::Value BpfFilter::matchMany(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<PacketView> packets;
+  Napi::Object opts;
+  if (!readPacketViews(info, packets, opts)) {
+    return env.Undefined();
+  }
+  bool indices = opts.Has("indices") && opts.Get("indices").ToBoolean();
+
+  if (indices) {
+    std::vector<uint32_t> matched;
+    for (size_t i{}; i < packets.size(); ++i) {
+      if (run(packets[i].data, packets[i].caplen, packets[i].wirelen)) {
+        matched.push_back(i);
+      }
+    }
+    auto res = Napi::Uint32Array::New(env, matched.size());
+    std::copy(matched.begin(), matched.end(), res.Data());
+    return res;
+  }
+
+  auto res = Napi::Uint8Array::New(env, (packets.size() + 7) / 8);
+  uint8_t* bitmap = res.Data();
+  std::fill(bitmap, bitmap + res.ElementLength(), 0);
+  for (size_t i{}; i < packets.size(); ++i) {
+    if (run(packets[i].data, packets[i].caplen, packets[i].wirelen)) {
+      bitmap[i / 8] |= 1 << (i % 8);
+    }
+  }
+  return res;
 }
 
 }
@@ -7,6 +7,9 @@
 #include "IpUtils.h"
 #include "SystemUtils.h"
 #include "pcap.h"
+#include "BpfEngine.hpp"
+#include "PacketViews.hpp"
+#include "FilterCache.hpp"
 
 /* Wrapper around PcapPlusPlus BpfFilterWrapper.
  * Wrapper around wrapper.
@@ -15,6 +18,11 @@
 namespace OverTheWire::BpfFilter {
   Napi::Object Init(Napi::Env env, Napi::Object exports);
 
+  const int defaultSnaplen = 65535;
+
+  // compiles with pcap_compile, the result is a copy owned by the caller
+  std::string compile(const std::string&, int linkType, program_t&, int snaplen = defaultSnaplen);
+
   struct BpfFilter : public Napi::ObjectWrap<BpfFilter> {
     static Napi::Object Init(Napi::Env, Napi::Object);
     BpfFilter(const Napi::CallbackInfo& info);
@@ -26,10 +34,36 @@ namespace OverTheWire::BpfFilter {
     Napi::Value getLinkType(const Napi::CallbackInfo&);
     void setLinkType(const Napi::CallbackInfo&, const Napi::Value&);
 
+    Napi::Value getEngine(const Napi::CallbackInfo&);
+    void setEngine(const Napi::CallbackInfo&, const Napi::Value&);
+
+    Napi::Value getBytecode(const Napi::CallbackInfo&);
+    void setBytecode(const Napi::CallbackInfo&, const Napi::Value&);
+
+    static Napi::Value warm(const Napi::CallbackInfo&);
+    static Napi::Value cacheStats(const Napi::CallbackInfo&);
+    static Napi::Value setCacheCapacity(const Napi::CallbackInfo&);
+    static Napi::Value clearCache(const Napi::CallbackInfo&);
+
     Napi::Value match(const Napi::CallbackInfo&);
+    Napi::Value matchMany(const Napi::CallbackInfo&);
+    bool run(const uint8_t*, size_t caplen, size_t wirelen);
+
+    std::string loadBytecode(const Napi::Value&);
+    std::string loadFilter();
+    void loadEngine();
 
     std::unique_ptr<pcpp::BpfFilterWrapper> obj;
     std::string filter = "";
+    // the compiled filter, shared through FilterCache, or the one it was made from when fromBytecode is set
+    program_ptr_t program;
+    // the expression the wrapper was given, it compiles its own copy on the first match on another link type
+    std::string wrapperFilter = "";
+    bool fromBytecode = false;
+    // runs the program unless it has something the engine doesn't know, or useEngine is off
+    BpfEngine engine;
+    bool useEngine = true;
     pcpp::LinkLayerType linkType = pcpp::LinkLayerType::LINKTYPE_ETHERNET;
+    int snaplen = defaultSnaplen;
   };
 }
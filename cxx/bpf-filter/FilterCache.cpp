@@ -0,0 +1,75 @@
+#include "FilterCache.hpp"
+#include "BpfFilter.hpp"
+
+namespace OverTheWire::BpfFilter {
+
+FilterCache& FilterCache::instance() {
+  // shared by the addon instances of all worker threads
+  static FilterCache cache;
+  return cache;
+}
+
+size_t FilterCache::KeyHash::operator()(const key_t& key) const {
+  size_t res = std::hash<std::string>{}(std::get<0>(key));
+  res ^= std::hash<int>{}(std::get<1>(key)) + 0x9e3779b9 + (res << 6) + (res >> 2);
+  res ^= std::hash<int>{}(std::get<2>(key)) + 0x9e3779b9 + (res << 6) + (res >> 2);
+  return res;
+}
+
+program_ptr_t FilterCache::get(const std::string& expr, int linkType, int snaplen, std::string& err) {
+  key_t key{expr, linkType, snaplen};
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      ++hits;
+      lru.splice(lru.begin(), lru, it->second);
+      return it->second->second;
+    }
+    ++misses;
+  }
+
+  // libpcap has its own lock, two threads missing the same key both compile
+  auto prog = std::make_shared<program_t>();
+  err = compile(expr, linkType, *prog, snaplen);
+  if (err.size() > 0) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    return it->second->second;
+  }
+  lru.emplace_front(key, prog);
+  entries.emplace(std::move(key), lru.begin());
+  while (entries.size() > capacity) {
+    entries.erase(lru.back().first);
+    lru.pop_back();
+  }
+  return prog;
+}
+
+FilterCacheStats FilterCache::stats() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return FilterCacheStats{hits, misses, entries.size(), capacity};
+}
+
+void FilterCache::setCapacity(size_t val) {
+  std::lock_guard<std::mutex> lock{mutex};
+  capacity = val;
+  while (entries.size() > capacity) {
+    entries.erase(lru.back().first);
+    lru.pop_back();
+  }
+}
+
+void FilterCache::clear() {
+  std::lock_guard<std::mutex> lock{mutex};
+  entries.clear();
+  lru.clear();
+  hits = 0;
+  misses = 0;
+}
+
+}
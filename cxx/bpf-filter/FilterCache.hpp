@@ -0,0 +1,55 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "pcap.h"
+
+/* Process-wide cache of compiled filters, keyed by (expression, link type, snaplen).
+ * pcap_compile() is slow and serialized inside libpcap, while the same few
+ * expressions get compiled over and over. The programs are immutable and
+ * shared by every filter, device and thread using them. The least recently
+ * used ones are dropped past the capacity.
+ */
+
+namespace OverTheWire::BpfFilter {
+
+  using program_t = std::vector<bpf_insn>;
+  using program_ptr_t = std::shared_ptr<const program_t>;
+
+  struct FilterCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+  };
+
+  struct FilterCache {
+    static FilterCache& instance();
+
+    // compiles on a miss, errors aren't cached
+    program_ptr_t get(const std::string&, int linkType, int snaplen, std::string& err);
+    FilterCacheStats stats();
+    void setCapacity(size_t);
+    void clear();
+
+    using key_t = std::tuple<std::string, int, int>;
+    struct KeyHash {
+      size_t operator()(const key_t&) const;
+    };
+    using lru_t = std::list<std::pair<key_t, program_ptr_t>>;
+
+    std::mutex mutex;
+    lru_t lru;
+    std::unordered_map<key_t, lru_t::iterator, KeyHash> entries;
+    size_t capacity = 1024;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+}
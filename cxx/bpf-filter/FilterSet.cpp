@@ -0,0 +1,216 @@
+#include "FilterSet.hpp"
+
+namespace OverTheWire::BpfFilter {
+
+Napi::Object FilterSet::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "FilterSet", {
+    InstanceMethod<&FilterSet::match>("match", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&FilterSet::matchMany>("matchMany", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceAccessor<&FilterSet::getSize>("size"),
+    InstanceAccessor<&FilterSet::getWords>("words"),
+    InstanceAccessor<&FilterSet::getStats>("stats"),
+  });
+
+  env.GetInstanceData<AddonData>()->SetClass(typeid(FilterSet), func);
+  exports.Set("FilterSet", func);
+  return exports;
+}
+
+bool FilterSet::Guard::operator==(const Guard& other) const {
+  return size == other.size && offset == other.offset && cmp == other.cmp && k == other.k && expect == other.expect;
+}
+
+bool FilterSet::Guard::pass(const PacketView& pkt, uint32_t& value) const {
+  // a load out of the packet ends the program with 0, so nothing under this check matches
+  if (offset > pkt.caplen || size > pkt.caplen - offset) {
+    return false;
+  }
+  const uint8_t* p = pkt.data + offset;
+  switch (size) {
+    case 4: value = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]; break;
+    case 2: value = (uint32_t(p[0]) << 8) | p[1]; break;
+    default: value = p[0];
+  }
+  bool res;
+  switch (cmp) {
+    case BpfEngine::jeq_k: res = value == k; break;
+    case BpfEngine::jgt_k: res = value > k; break;
+    case BpfEngine::jge_k: res = value >= k; break;
+    default: res = (value & k) != 0;
+  }
+  return res == expect;
+}
+
+FilterSet::FilterSet(const Napi::CallbackInfo& info) : Napi::ObjectWrap<FilterSet>{info} {
+  Napi::Env env = info.Env();
+  checkLength(info, 1);
+  if (!info[0].IsArray()) {
+    Napi::TypeError::New(env, "Expected an array of filter expressions").ThrowAsJavaScriptException();
+    return;
+  }
+  if (info.Length() > 1) {
+    linkType = static_cast<decltype(linkType)>(info[1].As<Napi::Number>().Uint32Value());
+  }
+
+  nodes.emplace_back();
+  Napi::Array exprs = info[0].As<Napi::Array>();
+  size = exprs.Length();
+  words = (size + 31) / 32;
+  for (uint32_t i{}; i < size; ++i) {
+    std::string expr = exprs.Get(i).As<Napi::String>().Utf8Value();
+    std::string err;
+    auto insns = FilterCache::instance().get(expr, linkType, defaultSnaplen, err);
+    if (!insns) {
+      Napi::Error::New(env, "Error compiling filter " + std::to_string(i) + " (" + expr + "): " + err).ThrowAsJavaScriptException();
+      return;
+    }
+    add(i, program_t{*insns});
+  }
+}
+
+void FilterSet::add(uint32_t filter, program_t&& insns) {
+  std::string key{(const char*)insns.data(), insns.size() * sizeof(bpf_insn)};
+  auto it = unique.find(key);
+  if (it != unique.end()) {
+    programs[it->second].filters.push_back(filter);
+    return;
+  }
+
+  uint32_t idx = programs.size();
+  unique.emplace(std::move(key), idx);
+  programs.emplace_back();
+  Program& prog = programs.back();
+  prog.filters.push_back(filter);
+  prog.insns = std::move(insns);
+
+  // bpf_filter() runs what the engine can't, from the root and without sharing
+  if (prog.engine.load(prog.insns).size() > 0) {
+    prog.engine.clear();
+    nodes[0].programs.push_back(idx);
+    return;
+  }
+
+  auto& ops = prog.engine.ops;
+  auto isRet0 = [&](uint32_t pc) { return ops[pc].code == BpfEngine::ret_k && ops[pc].k == 0; };
+  uint32_t node = 0;
+  uint32_t pc = 0;
+  while (pc + 1 < ops.size()) {
+    const auto& ld = ops[pc];
+    const auto& jmp = ops[pc + 1];
+    uint8_t width = ld.code == BpfEngine::ld_w_abs ? 4 : ld.code == BpfEngine::ld_h_abs ? 2 : ld.code == BpfEngine::ld_b_abs ? 1 : 0;
+    bool cmp = jmp.code == BpfEngine::jeq_k || jmp.code == BpfEngine::jgt_k || jmp.code == BpfEngine::jge_k || jmp.code == BpfEngine::jset_k;
+    if (width == 0 || !cmp) {
+      break;
+    }
+    // one branch goes on, the other one rejects the packet
+    bool expect;
+    if (jmp.jt == pc + 2 && jmp.jf != pc + 2 && isRet0(jmp.jf)) {
+      expect = true;
+    }
+    else if (jmp.jf == pc + 2 && jmp.jt != pc + 2 && isRet0(jmp.jt)) {
+      expect = false;
+    }
+    else {
+      break;
+    }
+
+    Guard guard{width, ld.k, jmp.code, jmp.k, expect};
+    uint32_t next = 0;
+    for (uint32_t child : nodes[node].children) {
+      if (nodes[child].guard == guard) {
+        next = child;
+        break;
+      }
+    }
+    if (next == 0) {
+      next = nodes.size();
+      nodes.push_back(GuardNode{guard, {}, {}});
+      nodes[node].children.push_back(next);
+    }
+    node = next;
+    pc += 2;
+  }
+  prog.start = pc;
+  nodes[node].programs.push_back(idx);
+}
+
+void FilterSet::visit(uint32_t node, const PacketView& pkt, uint32_t acc, uint32_t* mask) const {
+  const GuardNode& cur = nodes[node];
+  for (uint32_t idx : cur.programs) {
+    const Program& prog = programs[idx];
+    bool res = prog.engine.loaded()
+      ? prog.engine.run(pkt.data, pkt.wirelen, pkt.caplen, prog.start, acc) != 0
+      : bpf_filter(prog.insns.data(), pkt.data, pkt.wirelen, pkt.caplen) != 0;
+    if (res) {
+      for (uint32_t filter : prog.filters) {
+        mask[filter / 32] |= 1u << (filter % 32);
+      }
+    }
+  }
+  for (uint32_t child : cur.children) {
+    uint32_t value;
+    // A holds the last loaded value when the program goes on
+    if (nodes[child].guard.pass(pkt, value)) {
+      visit(child, pkt, value, mask);
+    }
+  }
+}
+
+void FilterSet::eval(const PacketView& pkt, uint32_t* mask) const {
+  visit(0, pkt, 0, mask);
+}
+
+Napi::Value FilterSet::getSize(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), size);
+}
+
+Napi::Value FilterSet::getWords(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), words);
+}
+
+Napi::Value FilterSet::getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  size_t native = 0;
+  size_t checks = 0;
+  for (const auto& prog : programs) {
+    native += prog.engine.loaded();
+    checks += prog.start / 2;
+  }
+  auto res = Napi::Object::New(env);
+  res.Set("filters", Napi::Number::New(env, size));
+  res.Set("programs", Napi::Number::New(env, programs.size()));
+  res.Set("native", Napi::Number::New(env, native));
+  // leading checks of all programs, and how many are left once they are shared
+  res.Set("checks", Napi::Number::New(env, checks));
+  res.Set("sharedChecks", Napi::Number::New(env, nodes.size() - 1));
+  return res;
+}
+
+Napi::Value FilterSet::match(const Napi::CallbackInfo& info) {
+  checkLength(info, 1);
+  js_buffer_t buf = info[0].As<js_buffer_t>();
+  auto res = Napi::Uint32Array::New(info.Env(), words);
+  std::fill(res.Data(), res.Data() + words, 0);
+  eval({buf.Data(), (uint32_t)buf.Length(), (uint32_t)buf.Length()}, res.Data());
+  return res;
+}
+
+// the same input as BpfFilter.matchMany, returns `words` masks per packet
+Napi::Value FilterSet::matchMany(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<PacketView> packets;
+  Napi::Object opts;
+  if (!readPacketViews(info, packets, opts)) {
+    return env.Undefined();
+  }
+  auto res = Napi::Uint32Array::New(env, packets.size() * words);
+  uint32_t* mask = res.Data();
+  std::fill(mask, mask + res.ElementLength(), 0);
+  for (const auto& pkt : packets) {
+    eval(pkt, mask);
+    mask += words;
+  }
+  return res;
+}
+
+}
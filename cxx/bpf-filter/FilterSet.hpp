@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+
+#include "common.hpp"
+#include "BpfFilter.hpp"
+
+/* Many filters evaluated together, every packet gets a bitmask of the
+ * filters it matched (bit i of word i / 32).
+ *
+ * pcap_compile() starts most programs with the same checks: the ethertype,
+ * the IP protocol... A check is a load from a fixed offset followed by a
+ * comparison whose failing branch returns 0. These leading checks of all
+ * programs form a tree, each check is evaluated once per packet however many
+ * programs start with it, and a failing check skips all of them. A program
+ * whose checks passed runs from its first instruction past them.
+ * Identical programs are run once.
+ */
+
+namespace OverTheWire::BpfFilter {
+
+  struct FilterSet : public Napi::ObjectWrap<FilterSet> {
+    struct Guard {
+      uint8_t size;
+      uint32_t offset;
+      BpfEngine::Opcode cmp;
+      uint32_t k;
+      bool expect;
+
+      bool operator==(const Guard&) const;
+      bool pass(const PacketView&, uint32_t& value) const;
+    };
+
+    struct GuardNode {
+      Guard guard;
+      std::vector<uint32_t> children;
+      // the programs whose leading checks end here
+      std::vector<uint32_t> programs;
+    };
+
+    struct Program {
+      program_t insns;
+      BpfEngine engine;
+      uint32_t start = 0;
+      std::vector<uint32_t> filters;
+    };
+
+    static Napi::Object Init(Napi::Env, Napi::Object);
+    FilterSet(const Napi::CallbackInfo&);
+
+    Napi::Value getSize(const Napi::CallbackInfo&);
+    Napi::Value getWords(const Napi::CallbackInfo&);
+    Napi::Value getStats(const Napi::CallbackInfo&);
+    Napi::Value match(const Napi::CallbackInfo&);
+    Napi::Value matchMany(const Napi::CallbackInfo&);
+
+    void add(uint32_t filter, program_t&&);
+    void eval(const PacketView&, uint32_t* mask) const;
+    void visit(uint32_t node, const PacketView&, uint32_t acc, uint32_t* mask) const;
+
+    pcpp::LinkLayerType linkType = pcpp::LinkLayerType::LINKTYPE_ETHERNET;
+    size_t size = 0;
+    size_t words = 0;
+    std::vector<Program> programs;
+    // the root (0) has no check
+    std::vector<GuardNode> nodes;
+    std::map<std::string, uint32_t> unique;
+  };
+
+}
@@ -0,0 +1,61 @@
+#include "PacketViews.hpp"
+
+namespace OverTheWire::BpfFilter {
+
+bool readPacketViews(const Napi::CallbackInfo& info, std::vector<PacketView>& res, Napi::Object& opts) {
+  checkLength(info, 1);
+  Napi::Env env = info.Env();
+  bool fromTable = info[0].IsBuffer();
+  if (!fromTable && !info[0].IsArray()) {
+    Napi::TypeError::New(env, "Expected an array of buffers or a buffer and an offsets table").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  size_t optIdx = fromTable ? 2 : 1;
+  opts = info.Length() > optIdx && info[optIdx].IsObject() ? info[optIdx].As<Napi::Object>() : Napi::Object::New(env);
+  size_t stride = opts.Has("stride") ? opts.Get("stride").As<Napi::Number>().Uint32Value() : 2;
+  int64_t wireField = opts.Has("wireLengthField") ? opts.Get("wireLengthField").As<Napi::Number>().Int64Value() : -1;
+  if (stride < 2 || wireField >= (int64_t)stride) {
+    Napi::RangeError::New(env, "Invalid stride or wireLengthField").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  if (fromTable) {
+    if (info.Length() < 2 || !info[1].IsTypedArray() || info[1].As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array) {
+      Napi::TypeError::New(env, "Expected a Uint32Array offsets table").ThrowAsJavaScriptException();
+      return false;
+    }
+    js_buffer_t buf = info[0].As<js_buffer_t>();
+    Napi::Uint32Array table = info[1].As<Napi::Uint32Array>();
+    size_t count = table.ElementLength() / stride;
+    res.reserve(count);
+    const uint32_t* row = table.Data();
+    for (size_t i{}; i < count; ++i, row += stride) {
+      size_t off = row[0];
+      size_t len = row[1];
+      if (off > buf.Length() || len > buf.Length() - off) {
+        Napi::RangeError::New(env, "Packet " + std::to_string(i) + " is out of the buffer").ThrowAsJavaScriptException();
+        return false;
+      }
+      res.push_back({buf.Data() + off, (uint32_t)len, wireField >= 0 ? row[wireField] : (uint32_t)len});
+    }
+    return true;
+  }
+
+  Napi::Array ar = info[0].As<Napi::Array>();
+  size_t count = ar.Length();
+  res.reserve(count);
+  for (size_t i{}; i < count; ++i) {
+    Napi::Value val = ar.Get(i);
+    if (!val.IsBuffer()) {
+      Napi::TypeError::New(env, "Element " + std::to_string(i) + " is not a buffer").ThrowAsJavaScriptException();
+      return false;
+    }
+    // the array holds the buffers, they outlive the call
+    js_buffer_t buf = val.As<js_buffer_t>();
+    res.push_back({buf.Data(), (uint32_t)buf.Length(), (uint32_t)buf.Length()});
+  }
+  return true;
+}
+
+}
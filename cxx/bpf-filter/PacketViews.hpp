@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace OverTheWire::BpfFilter {
+
+  struct PacketView {
+    const uint8_t* data;
+    uint32_t caplen;
+    uint32_t wirelen;
+  };
+
+  /* Reads the packets of a batch call: (buffers[], options) or
+   * (buffer, table, options), the table holding options.stride uint32 per
+   * packet, the offset and the length first, and the length on the wire at
+   * options.wireLengthField if there's one. On bad input throws and returns false.
+   */
+  bool readPacketViews(const Napi::CallbackInfo&, std::vector<PacketView>&, Napi::Object& opts);
+
+}
@@ -133,3 +133,5 @@ using cxx_buffer_t = std::pair<std::unique_ptr<uint8_t>, size_t>;
 
 c_buffer_t toCxx(const Napi::Value&&);
 c_buffer_t toCxx(const Napi::Value&);
+// no copy, the caller has to keep the JS value referenced while the memory is in use
+c_buffer_t toCxxView(const Napi::Value&);
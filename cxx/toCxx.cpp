@@ -24,3 +24,21 @@ c_buffer_t toCxx(const Napi::Value& input) {
 c_buffer_t toCxx(const Napi::Value&& input) {
   return toCxx(input);
 }
+
+c_buffer_t toCxxView(const Napi::Value& input) {
+  auto res = std::make_pair((uint8_t*)nullptr, size_t{});
+  if (input.IsBuffer()) {
+    js_buffer_t inputBuf = input.As<js_buffer_t>();
+    res.first = inputBuf.Data();
+    res.second = inputBuf.Length();
+  }
+  else if (input.IsTypedArray()) {
+    Napi::TypedArray inputAr = input.As<Napi::TypedArray>();
+    res.first = static_cast<uint8_t*>(inputAr.ArrayBuffer().Data()) + inputAr.ByteOffset();
+    res.second = inputAr.ByteLength();
+  }
+  else {
+    Napi::Error::New(input.Env(), "Invalid input type, expected either Buffer of TypedArray").ThrowAsJavaScriptException();
+  }
+  return res;
+}
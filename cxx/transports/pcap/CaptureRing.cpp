@@ -0,0 +1,81 @@
+#include "CaptureRing.hpp"
+
+namespace OverTheWire::Transports::Pcap {
+
+static uint32_t align8(uint32_t v) {
+  return (v + 7) & ~uint32_t{7};
+}
+
+bool CaptureRing::fits(size_t size) {
+  return size >= dataOff + 4096;
+}
+
+CaptureRing::CaptureRing(uint8_t* mem, size_t size) : mem{mem}, data{mem + dataOff} {
+  size_t avail = size - dataOff;
+  capacity = 1;
+  while (size_t{capacity} * 2 <= avail && capacity < (uint32_t{1} << 31)) {
+    capacity *= 2;
+  }
+
+  word(capacityOff).store(capacity, std::memory_order_relaxed);
+  word(droppedOff).store(0, std::memory_order_relaxed);
+  word(seqOff).store(0, std::memory_order_relaxed);
+  word(headOff).store(0, std::memory_order_relaxed);
+  word(tailOff).store(0, std::memory_order_relaxed);
+  word(waitingOff).store(1, std::memory_order_relaxed);
+  word(magicOff).store(magic, std::memory_order_release);
+}
+
+std::atomic<uint32_t>& CaptureRing::word(size_t off) {
+  return *reinterpret_cast<std::atomic<uint32_t>*>(mem + off);
+}
+
+bool CaptureRing::write(const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+  uint32_t need = align8(recordHeader + len);
+  if (need > capacity / 2) {
+    word(droppedOff).fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint32_t head = word(headOff).load(std::memory_order_relaxed);
+  uint32_t tail = word(tailOff).load(std::memory_order_acquire);
+  uint32_t pos = head & (capacity - 1);
+  uint32_t toEnd = capacity - pos;
+  uint32_t total = need + (toEnd < need ? toEnd : 0);
+
+  if (capacity - (head - tail) < total) {
+    word(droppedOff).fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (toEnd < need) {
+    reinterpret_cast<uint32_t*>(data + pos)[0] = wrapMarker;
+    head += toEnd;
+    pos = 0;
+  }
+
+  uint32_t* hdr = reinterpret_cast<uint32_t*>(data + pos);
+  hdr[0] = len;
+  hdr[1] = origLen;
+  hdr[2] = static_cast<uint32_t>(ts.tv_sec);
+  hdr[3] = static_cast<uint32_t>(ts.tv_nsec);
+  std::memcpy(data + pos + recordHeader, buf, len);
+
+  word(headOff).store(head + need, std::memory_order_release);
+  return true;
+}
+
+bool CaptureRing::takeWaiting() {
+  // pairs with the consumer storing waiting and then re-reading head
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (word(waitingOff).load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  return word(waitingOff).exchange(0, std::memory_order_acq_rel) == 1;
+}
+
+uint32_t CaptureRing::dropped() {
+  return word(droppedOff).load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+#include "common.hpp"
+
+/* Single-producer/single-consumer ring living in memory owned by JS
+ * (usually a SharedArrayBuffer, so a worker thread can be the consumer).
+ * The capture thread writes records in place, JS reads them in place and
+ * moves the tail forward, nothing is allocated per packet.
+ *
+ * Layout (all numbers are little-endian u32, see lib/captureRing.js):
+ *   [0]   magic        [8]  capacity   [12] dropped
+ *   [16]  waiting      [20] seq (bumped by JS when it wakes a consumer)
+ *   [64]  head         [128] tail      [192] data...
+ * head and tail are free-running byte counters, capacity is a power of two.
+ * A record is { len, origLen, tsSec, tsNsec } followed by the frame,
+ * padded to 8 bytes. len == wrapMarker means "continue from the start".
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  struct CaptureRing {
+    enum Offset : size_t {
+      magicOff = 0,
+      capacityOff = 8,
+      droppedOff = 12,
+      waitingOff = 16,
+      seqOff = 20,
+      headOff = 64,
+      tailOff = 128,
+      dataOff = 192,
+    };
+
+    static constexpr uint32_t magic = 0x5257544f;
+    static constexpr uint32_t wrapMarker = 0xffffffff;
+    static constexpr uint32_t recordHeader = 16;
+
+    static bool fits(size_t);
+
+    CaptureRing(uint8_t*, size_t);
+
+    bool write(const uint8_t*, uint32_t, uint32_t, const timespec&);
+    bool takeWaiting();
+    uint32_t dropped();
+
+    std::atomic<uint32_t>& word(size_t);
+
+    uint8_t* mem;
+    uint8_t* data;
+    uint32_t capacity;
+  };
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be layout-compatible with uint32_t");
+}
@@ -0,0 +1,117 @@
+#include "DeliveryQueue.hpp"
+
+namespace OverTheWire::Transports::Pcap {
+
+DeliveryQueue::DeliveryQueue(const QueueConfig& config) : config{config} {}
+
+DeliveryQueue::~DeliveryQueue() {
+  for (auto* batch : items) {
+    delete batch;
+  }
+}
+
+void DeliveryQueue::configure(const QueueConfig& newConfig) {
+  std::lock_guard<std::mutex> lock{mutex};
+  config = newConfig;
+}
+
+void DeliveryQueue::setSchedule(schedule_t fn) {
+  std::lock_guard<std::mutex> lock{mutex};
+  schedule = fn;
+}
+
+void DeliveryQueue::dropLocked(PacketBatch* batch) {
+  dropped += batch->size();
+  delete batch;
+}
+
+void DeliveryQueue::offer(PacketBatch* batch) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (packets + batch->size() > config.highWatermark) {
+      overflowing = true;
+    }
+    else if (packets <= config.lowWatermark) {
+      overflowing = false;
+    }
+
+    if (overflowing) {
+      if (config.policy == DropPolicy::newest) {
+        dropLocked(batch);
+        return;
+      }
+      while (!items.empty() && packets + batch->size() > config.lowWatermark) {
+        packets -= items.front()->size();
+        dropLocked(items.front());
+        items.pop_front();
+      }
+      overflowing = false;
+    }
+
+    packets += batch->size();
+    items.push_back(batch);
+
+    if (!paused && !scheduled && schedule) {
+      scheduled = true;
+      wake = true;
+    }
+  }
+
+  if (wake) {
+    schedule();
+  }
+}
+
+PacketBatch* DeliveryQueue::take() {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (paused || items.empty()) {
+    // the next offer() or resume() schedules a new drain
+    scheduled = false;
+    return nullptr;
+  }
+  auto* batch = items.front();
+  items.pop_front();
+  packets -= batch->size();
+  return batch;
+}
+
+void DeliveryQueue::pause() {
+  std::lock_guard<std::mutex> lock{mutex};
+  paused = true;
+}
+
+void DeliveryQueue::resume() {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    paused = false;
+    if (!items.empty() && !scheduled && schedule) {
+      scheduled = true;
+      wake = true;
+    }
+  }
+
+  if (wake) {
+    schedule();
+  }
+}
+
+void DeliveryQueue::reschedule() {
+  schedule_t fn;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    fn = schedule;
+  }
+  if (fn) {
+    fn();
+  }
+}
+
+QueueStats DeliveryQueue::stats() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return { packets, items.size(), dropped };
+}
+
+}
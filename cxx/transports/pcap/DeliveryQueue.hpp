@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <functional>
+
+#include "common.hpp"
+#include "PacketBatch.hpp"
+
+/* Batches waiting to be pushed into the JS stream. The capture thread
+ * never waits for JS: once the queue holds highWatermark packets it starts
+ * dropping (the newest or the oldest batches, depending on the policy)
+ * until it is back under lowWatermark. JS pauses delivery when the stream
+ * is full and resumes it from _read, the capture itself keeps running.
+ *
+ * At most one TSFN call is in flight at a time (`scheduled`), it drains
+ * the queue on the JS thread.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  const size_t maxDrainPerCall = 64;
+
+  enum class DropPolicy { newest, oldest };
+
+  struct QueueConfig {
+    size_t highWatermark = 1 << 16;
+    size_t lowWatermark = 1 << 15;
+    DropPolicy policy = DropPolicy::newest;
+  };
+
+  struct QueueStats {
+    size_t depth = 0;
+    size_t batches = 0;
+    uint64_t dropped = 0;
+  };
+
+  struct DeliveryQueue {
+    using schedule_t = std::function<void()>;
+
+    DeliveryQueue(const QueueConfig&);
+    ~DeliveryQueue();
+
+    void configure(const QueueConfig&);
+    void setSchedule(schedule_t);
+    void offer(PacketBatch*);
+    PacketBatch* take();
+    void pause();
+    void resume();
+    void reschedule();
+    QueueStats stats();
+
+    void dropLocked(PacketBatch*);
+
+    QueueConfig config;
+    schedule_t schedule;
+
+    std::mutex mutex;
+    std::deque<PacketBatch*> items;
+    size_t packets = 0;
+    uint64_t dropped = 0;
+    bool overflowing = false;
+    bool paused = false;
+    bool scheduled = false;
+  };
+}
@@ -0,0 +1,114 @@
+#include "Injector.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include "error/Error.hpp"
+#endif
+
+namespace OverTheWire::Transports::Pcap {
+
+#ifdef __linux__
+
+int sendFrames(SOCKET fd, const pcpp::RawPacket* packets, int n) {
+  mmsghdr msgs[maxFramesPerSend];
+  iovec iovs[maxFramesPerSend];
+  int accepted = 0;
+
+  while (accepted < n) {
+    int count = std::min(n - accepted, maxFramesPerSend);
+    for (int i{}; i < count; ++i) {
+      const auto& packet = packets[accepted + i];
+      iovs[i].iov_base = const_cast<uint8_t*>(packet.getRawData());
+      iovs[i].iov_len = packet.getRawDataLen();
+      msgs[i] = mmsghdr{};
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int res;
+    do {
+      res = ::sendmmsg(fd, msgs, count, 0);
+    } while (res == -1 && errno == EINTR);
+
+    if (res <= 0) {
+      break;
+    }
+    accepted += res;
+    if (res < count) {
+      // the next frame failed, the caller decides whether to retry it
+      break;
+    }
+  }
+  return accepted;
+}
+
+Injector::~Injector() {
+  close();
+}
+
+std::string Injector::open(const std::string& iface, bool qdiscBypass) {
+  int ifindex = if_nametoindex(iface.c_str());
+  if (ifindex == 0) {
+    return "Could not find device";
+  }
+
+  // protocol 0: the socket only sends, nothing is queued for it on receive
+  fd = ::socket(AF_PACKET, SOCK_RAW, 0);
+  if (fd < 0) {
+    return getSystemError();
+  }
+
+  if (qdiscBypass) {
+    int one = 1;
+    if (::setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one)) < 0) {
+      auto err = getSystemError();
+      close();
+      return err;
+    }
+  }
+
+  sockaddr_ll addr{};
+  addr.sll_family = AF_PACKET;
+  addr.sll_ifindex = ifindex;
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    auto err = getSystemError();
+    close();
+    return err;
+  }
+  return "";
+}
+
+int Injector::send(const pcpp::RawPacket* packets, int n) {
+  return sendFrames(fd, packets, n);
+}
+
+void Injector::close() {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+#else
+
+int sendFrames(SOCKET fd, const pcpp::RawPacket* packets, int n) {
+  int sent = 0;
+  for (; sent < n; ++sent) {
+    if (::send(fd, reinterpret_cast<const char*>(packets[sent].getRawData()), packets[sent].getRawDataLen(), 0) < 0) {
+      break;
+    }
+  }
+  return sent;
+}
+
+Injector::~Injector() {}
+std::string Injector::open(const std::string&, bool) { return "sendmmsg injection is only supported on Linux"; }
+int Injector::send(const pcpp::RawPacket*, int) { return 0; }
+void Injector::close() {}
+
+#endif
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.hpp"
+#include "RawPacket.h"
+
+/* Linux-only injection backend for the pcap capture backend. libpcap
+ * sends one frame per syscall, this hands a whole write to the kernel
+ * with sendmmsg on a plain AF_PACKET socket, the frames are read straight
+ * out of the JS buffers. Errors are reported as strings like in TPacket.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  // frames handed to a single sendmmsg call
+  const int maxFramesPerSend = 256;
+
+  /* Sends up to n frames on a bound packet socket (or any connected
+   * socket) and returns how many the kernel accepted, it stops at the
+   * first frame that was refused. One send per frame outside Linux.
+   */
+  int sendFrames(SOCKET, const pcpp::RawPacket*, int);
+
+  struct Injector {
+    ~Injector();
+
+    std::string open(const std::string&, bool);
+    int send(const pcpp::RawPacket*, int);
+    void close();
+
+    int fd = -1;
+  };
+}
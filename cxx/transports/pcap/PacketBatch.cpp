@@ -0,0 +1,112 @@
+#include "PacketBatch.hpp"
+
+namespace OverTheWire::Transports::Pcap {
+
+PacketBatch::PacketBatch(size_t reserve) {
+  arena.reserve(reserve);
+}
+
+void PacketBatch::add(const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+  size_t off = arena.size();
+  arena.insert(arena.end(), buf, buf + len);
+  meta.insert(meta.end(), {
+    static_cast<uint32_t>(off),
+    len,
+    origLen,
+    static_cast<uint32_t>(ts.tv_sec),
+    static_cast<uint32_t>(ts.tv_nsec),
+  });
+}
+
+size_t PacketBatch::size() const {
+  return meta.size() / fields;
+}
+
+uint8_t* PacketBatch::data() {
+  return arena.data();
+}
+
+size_t PacketBatch::bytes() const {
+  return arena.size();
+}
+
+Batcher::Batcher(const BatchConfig& config, flush_t onFlush) : config{config}, onFlush{onFlush} {}
+
+Batcher::~Batcher() {
+  stop();
+}
+
+void Batcher::start() {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (running) return;
+  running = true;
+  if (config.enabled()) {
+    timer = std::thread{&Batcher::timerMain, this};
+  }
+}
+
+void Batcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (!running) return;
+    running = false;
+  }
+  cv.notify_all();
+  if (timer.joinable()) {
+    timer.join();
+  }
+  std::lock_guard<std::mutex> lock{mutex};
+  flushLocked();
+}
+
+void Batcher::add(const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+  if (!config.enabled()) {
+    auto* single = new PacketBatch{len};
+    single->packed = false;
+    single->add(buf, len, origLen, ts);
+    onFlush(single);
+    return;
+  }
+
+  bool first = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (!current) {
+      current = std::make_unique<PacketBatch>(std::min(config.bytes, size_t{1} << 16));
+      firstAt = std::chrono::steady_clock::now();
+      first = true;
+    }
+    current->add(buf, len, origLen, ts);
+    if (current->size() >= config.packets || current->bytes() >= config.bytes) {
+      flushLocked();
+      first = false;
+    }
+  }
+
+  if (first) {
+    cv.notify_one();
+  }
+}
+
+void Batcher::flushLocked() {
+  if (current && current->size() > 0) {
+    onFlush(current.release());
+  }
+  current.reset();
+}
+
+void Batcher::timerMain() {
+  std::unique_lock<std::mutex> lock{mutex};
+  while (running) {
+    if (!current) {
+      cv.wait(lock);
+      continue;
+    }
+    cv.wait_until(lock, firstAt + std::chrono::microseconds(config.timeoutUs));
+    if (current && std::chrono::steady_clock::now() >= firstAt + std::chrono::microseconds(config.timeoutUs)) {
+      flushLocked();
+    }
+  }
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include "common.hpp"
+
+/* Captured packets packed into one contiguous arena, so the capture thread
+ * can hand a whole bunch of them to JS with a single TSFN call instead of
+ * crossing the N-API boundary for every frame. Each packet is described by
+ * PacketBatch::fields numbers in the meta table, see the enum below
+ * (lib/packetBatch.js reads the same layout).
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  const size_t defaultBatchTimeoutUs = 1'000;
+  const size_t defaultBatchBytes = 4 << 20;
+
+  struct PacketBatch {
+    enum Field : size_t { offset, length, origLength, tsSec, tsNsec, fields };
+
+    PacketBatch(size_t reserve = 0);
+    virtual ~PacketBatch() = default;
+
+    void add(const uint8_t*, uint32_t, uint32_t, const timespec&);
+    size_t size() const;
+
+    virtual uint8_t* data();
+    virtual size_t bytes() const;
+
+    std::vector<uint8_t> arena;
+    std::vector<uint32_t> meta;
+    bool packed = true;
+  };
+
+  struct BatchConfig {
+    size_t packets = 0;
+    size_t timeoutUs = defaultBatchTimeoutUs;
+    size_t bytes = defaultBatchBytes;
+
+    bool enabled() const { return packets > 1; }
+  };
+
+  /* Collects packets on the capture thread and flushes a batch when it holds
+   * enough packets or bytes, or when the oldest packet in it is older than
+   * timeoutUs. libpcap only calls us back when something arrives, so the
+   * time threshold is enforced by a small timer thread.
+   * When batching is disabled every packet is flushed on its own.
+   */
+  struct Batcher {
+    using flush_t = std::function<void(PacketBatch*)>;
+
+    Batcher(const BatchConfig&, flush_t);
+    ~Batcher();
+
+    void add(const uint8_t*, uint32_t, uint32_t, const timespec&);
+    void start();
+    void stop();
+
+    void flushLocked();
+    void timerMain();
+
+    BatchConfig config;
+    flush_t onFlush;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread timer;
+    bool running = false;
+
+    std::unique_ptr<PacketBatch> current;
+    std::chrono::steady_clock::time_point firstAt;
+  };
+}
@@ -1,33 +1,26 @@
 #include "Pcap.hpp"
+#include "Replay.hpp"
+#include "bpf-filter/BpfFilter.hpp"
 
 namespace OverTheWire::Transports::Pcap {
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   PcapDevice::Init(env, exports);
+  Replay::Init(env, exports);
   return exports;
 }
 
-SendWorker::SendWorker(device_ptr_t dev, Napi::Function& callback, packets_t&& packets) :
-  AsyncWorker{callback}, dev{dev}, callback{callback}, packets{packets} {}
-
-SendWorker::~SendWorker() {}
-
-void SendWorker::Execute() {
-  DEBUG_OUTPUT("SendWorker::Execute");
-  auto res = dev->sendPackets(packets.data(), packets.size());
-  if (!res) {
-    SetError("Error sending packet");
-  }
-}
-
 Napi::Object PcapDevice::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(env, "PcapDevice", {
     InstanceMethod<&PcapDevice::_write>("_write", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&PcapDevice::_inject>("_inject", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::setFilter>("setFilter", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::setConfig>("setConfig", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::open>("open", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::startCapture>("startCapture", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::stopCapture>("stopCapture", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&PcapDevice::resume>("resume", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&PcapDevice::attachRing>("attachRing", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&PcapDevice::_destroy>("_destroy", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceAccessor<&PcapDevice::interfaceInfo>("interfaceInfo"),
     InstanceAccessor<&PcapDevice::stats>("stats"),
@@ -38,17 +31,67 @@ Napi::Object PcapDevice::Init(Napi::Env env, Napi::Object exports) {
   return exports;
 }
 
-void CallJs(Napi::Env env, Napi::Function jsCallback, Context* context, pcpp::RawPacket* packet) {
-  DEBUG_OUTPUT((std::stringstream{} << "CallJs: " << (void*)packet->getRawData() << packet->getRawDataLen()).str());
-  if (env != nullptr && jsCallback != nullptr) {
-    jsCallback.Call({ js_buffer_t::Copy(env, packet->getRawData(), packet->getRawDataLen()) });
+static Napi::Value pushBatch(Napi::Env env, Napi::Function& jsCallback, PacketBatch* batch) {
+  DEBUG_OUTPUT((std::stringstream{} << "pushBatch: " << batch->size() << " packet(s), " << batch->bytes() << " bytes").str());
+  auto buf = js_buffer_t::NewOrCopy(env, batch->data(), batch->bytes(), [](Napi::Env, uint8_t*, PacketBatch* batch) {
+    DEBUG_OUTPUT("Deleting packet batch");
+    delete batch;
+  }, batch);
+
+  if (!batch->packed) {
+    return jsCallback.Call({ buf });
   }
+
+  auto meta = Napi::Uint32Array::New(env, batch->meta.size());
+  std::memcpy(meta.Data(), batch->meta.data(), batch->meta.size() * sizeof(uint32_t));
+  return jsCallback.Call({ buf, meta });
+}
+
+void CallJs(Napi::Env env, Napi::Function jsCallback, Context* queue, PacketBatch*) {
+  DEBUG_OUTPUT("CallJs");
+  if (env == nullptr || jsCallback == nullptr) {
+    return;
+  }
+
+  for (size_t i{}; i < maxDrainPerCall; ++i) {
+    auto* batch = queue->take();
+    if (!batch) {
+      return;
+    }
+    // push() returns false once the stream buffer is full
+    auto res = pushBatch(env, jsCallback, batch);
+    if (res.IsEmpty() || !res.ToBoolean()) {
+      queue->pause();
+    }
+  }
+
+  // give the event loop a chance, the rest goes in the next call
+  queue->reschedule();
+}
+
+void CallJsEvent(Napi::Env env, Napi::Function jsCallback, EventContext* context, DeviceEvent* event) {
+  std::unique_ptr<DeviceEvent> guard{event};
+  if (env == nullptr || jsCallback == nullptr) {
+    return;
+  }
+
+  Napi::Object data = Napi::Object::New(env);
+  for (auto& [k, v] : event->fields) {
+    if (std::holds_alternative<double>(v)) {
+      data.Set(k, Napi::Number::New(env, std::get<double>(v)));
+    }
+    else {
+      data.Set(k, Napi::String::New(env, std::get<std::string>(v)));
+    }
+  }
+
+  jsCallback.Call({ Napi::String::New(env, event->name), data });
 }
 
 void onPacketArrivesRaw(pcpp::RawPacket* packet, pcpp::PcapLiveDevice* dev, void* cookie) {
   DEBUG_OUTPUT("onPacketArrivesRaw");
-  auto* push = reinterpret_cast<TSFN*>(cookie);
-  push->BlockingCall(packet);
+  auto* self = reinterpret_cast<PcapDevice*>(cookie);
+  self->ingest(packet->getRawData(), packet->getRawDataLen(), packet->getFrameLength(), packet->getPacketTimeStamp());
 }
 
 PcapDevice::PcapDevice(const Napi::CallbackInfo& info) : Napi::ObjectWrap<PcapDevice>{info} {
@@ -75,42 +118,276 @@ PcapDevice::PcapDevice(const Napi::CallbackInfo& info) : Napi::ObjectWrap<PcapDe
     return;
   }
 
+  queue = new DeliveryQueue{queueConfig};
+  // the queue makes sure only one call is pending at a time, so the TSFN queue stays tiny
   push = TSFN::New(
     info.Env(),
     obj.Get("push").As<Napi::Function>(),
     "push",
     0,
     1,
-    nullptr,
-    [](Napi::Env, FinalizerDataType*, Context*) {
+    queue,
+    [](Napi::Env, FinalizerDataType*, Context* queue) {
       DEBUG_OUTPUT("TSFN destructor");
+      delete queue;
     }
   );
 
   hasPush = true;
+  queue->setSchedule([this]() {
+    push.BlockingCall();
+  });
+
+  transmitter = new Transmitter{txQueueSize};
+  tx = TxTSFN::New(
+    info.Env(),
+    "tx",
+    0,
+    1,
+    transmitter,
+    [](Napi::Env, FinalizerDataType*, Transmitter* transmitter) {
+      DEBUG_OUTPUT("TX TSFN destructor");
+      delete transmitter;
+    }
+  );
+  hasTx = true;
+  transmitter->setSchedule([this]() {
+    tx.NonBlockingCall();
+  });
+
+  if (obj.Has("event")) {
+    events = EventTSFN::New(
+      info.Env(),
+      obj.Get("event").As<Napi::Function>(),
+      "event",
+      0,
+      1,
+      nullptr,
+      [](Napi::Env, FinalizerDataType*, EventContext*) {
+        DEBUG_OUTPUT("Event TSFN destructor");
+      }
+    );
+
+    hasEvents = true;
+  }
 }
 
 Napi::Value PcapDevice::open(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("open");
-  if (!dev->open(config)) {
+  if (tpacketConfig.fanoutMode >= 0 && backend != "tpacket") {
+    Napi::Error::New(info.Env(), "Fanout groups require the tpacket backend").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  if (backend == "tpacket") {
+    tpacketConfig.promiscuous = config.mode == pcpp::PcapLiveDevice::DeviceMode::Promiscuous;
+    tpacketConfig.in = config.direction != pcpp::PcapLiveDevice::PcapDirection::PCPP_OUT;
+    tpacketConfig.out = config.direction != pcpp::PcapLiveDevice::PcapDirection::PCPP_IN;
+
+    tpacket = std::make_unique<TPacketCapture>();
+    auto err = tpacket->open(dev->getName(), tpacketConfig);
+    if (err.size() > 0) {
+      tpacket.reset();
+      Napi::Error::New(info.Env(), "Could not open device: " + err).ThrowAsJavaScriptException();
+    }
+  }
+  else if (backend == "xdp") {
+    xdp = std::make_unique<Xdp::XdpSocket>();
+    auto err = xdp->open(dev->getName(), xdpConfig);
+    if (err.size() > 0) {
+      xdp.reset();
+      Napi::Error::New(info.Env(), "Could not open device: " + err).ThrowAsJavaScriptException();
+    }
+  }
+  else if (!dev->open(config)) {
     Napi::Error::New(info.Env(), "Could not open device").ThrowAsJavaScriptException();
   }
+  else if (txBackend == "sendmmsg") {
+    injector = std::make_unique<Injector>();
+    auto err = injector->open(dev->getName(), txQdiscBypass);
+    if (err.size() > 0) {
+      injector.reset();
+      dev->close();
+      Napi::Error::New(info.Env(), "Could not open device: " + err).ThrowAsJavaScriptException();
+    }
+  }
 
   return info.Env().Undefined();
 }
 
+void PcapDevice::ingest(const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+  if (recorder) {
+    recorder->write(buf, len, origLen, ts);
+    return;
+  }
+
+  if (ring) {
+    ring->write(buf, len, origLen, ts);
+    if (ring->takeWaiting()) {
+      emitEvent(new DeviceEvent{"ring"});
+    }
+    return;
+  }
+
+  batcher->add(buf, len, origLen, ts);
+}
+
+void PcapDevice::emitEvent(DeviceEvent* event) {
+  if (!hasEvents || events.NonBlockingCall(event) != napi_ok) {
+    delete event;
+  }
+}
+
 Napi::Value PcapDevice::startCapture(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("startCapture");
-  dev->startCapture(onPacketArrivesRaw, &push);
+  auto onBatch = [this](PacketBatch* batch) {
+    queue->offer(batch);
+  };
+
+  auto onPacket = [this](const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+    ingest(buf, len, origLen, ts);
+  };
+
+  if (recorderConfig.enabled()) {
+    auto err = startRecorder();
+    if (err.size() > 0) {
+      Napi::Error::New(info.Env(), "Could not start recording: " + err).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // packets that end up in the ring or in a file are handled one by one on the capture thread
+  bool direct = ring || recorder;
+
+  if (!direct && !tpacket && !xdp) {
+    batcher = std::make_unique<Batcher>(batchConfig, onBatch);
+    batcher->start();
+  }
+
+  bool ok;
+  if (tpacket) {
+    // whole blocks go to JS unless every packet has to be copied anyway
+    ok = tpacket->start(direct ? nullptr : TPacketCapture::on_block_t{onBatch}, onPacket);
+  }
+  else if (xdp) {
+    // one batch per rx burst
+    ok = xdp->start(direct ? nullptr : Xdp::XdpSocket::on_batch_t{onBatch}, onPacket);
+  }
+  else {
+    ok = dev->startCapture(onPacketArrivesRaw, this);
+  }
+
+  if (!ok) {
+    batcher.reset();
+    recorder.reset();
+    Napi::Error::New(info.Env(), "Could not start capture").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  queue->resume();
   return info.Env().Undefined();
 }
 
+void PcapDevice::stopCapture() {
+  if (tpacket) {
+    tpacket->stop();
+  }
+  else if (xdp) {
+    xdp->stop();
+  }
+  else if (dev->captureActive()) {
+    dev->stopCapture();
+  }
+  if (batcher) {
+    batcher->stop();
+    batcher.reset();
+  }
+  if (recorder) {
+    // flushes the file and reports it while the event TSFN is still alive
+    recorder->close();
+    // a restart goes on after this session instead of writing over it
+    recorderConfig.firstIndex = recorder->index + 1;
+    recorderConfig.append = true;
+  }
+}
+
+std::string PcapDevice::startRecorder() {
+  RecorderConfig cfg = recorderConfig;
+  if (config.snapshotLength > 0) {
+    cfg.snaplen = config.snapshotLength;
+  }
+  cfg.linkType = tpacket || xdp ? pcpp::LINKTYPE_ETHERNET : dev->getLinkType();
+
+  recorder = std::make_unique<Recorder>(cfg, [this](const std::string& path, uint64_t index, uint64_t packets, uint64_t bytes) {
+    emitEvent(new DeviceEvent{"rotated", {
+      { "path", path },
+      { "index", static_cast<double>(index) },
+      { "packets", static_cast<double>(packets) },
+      { "bytes", static_cast<double>(bytes) },
+    }});
+  }, [this](const std::string& err) {
+    emitEvent(new DeviceEvent{"recordError", {{ "message", err }}});
+  });
+
+  auto err = recorder->open();
+  if (err.size() > 0) {
+    recorder.reset();
+  }
+  return err;
+}
+
 Napi::Value PcapDevice::stopCapture(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("stopCapture");
-  dev->stopCapture();
+  stopCapture();
   return info.Env().Undefined();
 }
 
+Napi::Value PcapDevice::resume(const Napi::CallbackInfo& info) {
+  if (queue) {
+    queue->resume();
+  }
+  return info.Env().Undefined();
+}
+
+Napi::Value PcapDevice::attachRing(const Napi::CallbackInfo& info) {
+  DEBUG_OUTPUT("attachRing");
+  checkLength(info, 1);
+  Napi::Env env = info.Env();
+
+  if (dev->captureActive() || (tpacket && tpacket->active()) || (xdp && xdp->active())) {
+    Napi::Error::New(env, "Could not attach ring while capturing").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (!info[0].IsTypedArray()) {
+    Napi::Error::New(env, "Expected Uint8Array over a (Shared)ArrayBuffer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Uint8Array view = info[0].As<Napi::Uint8Array>();
+  if (!CaptureRing::fits(view.ByteLength()) || reinterpret_cast<uintptr_t>(view.Data()) % 8 != 0) {
+    Napi::Error::New(env, "Ring memory is too small or not aligned").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  ring = std::make_unique<CaptureRing>(view.Data(), view.ByteLength());
+  ringRef = Napi::Reference<Napi::Value>::New(view, 1);
+
+  return Napi::Number::New(env, ring->capacity);
+}
+
+static const std::map<std::string, int> fanoutModes = {
+#ifdef __linux__
+  { "hash", PACKET_FANOUT_HASH },
+  { "lb", PACKET_FANOUT_LB },
+  { "roundrobin", PACKET_FANOUT_LB },
+  { "cpu", PACKET_FANOUT_CPU },
+  { "rollover", PACKET_FANOUT_ROLLOVER },
+  { "random", PACKET_FANOUT_RND },
+  { "qm", PACKET_FANOUT_QM },
+#endif
+};
+
 Napi::Value PcapDevice::setConfig(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("setConfig");
   checkLength(info, 1);
@@ -184,22 +461,246 @@ Napi::Value PcapDevice::setConfig(const Napi::CallbackInfo& info) {
     obj.Set("nflogGroup", Napi::Number::New(env, config.nflogGroup));
   }
 
+  if (obj.Has("backend")) {
+    std::string newBackend = obj.Get("backend").As<Napi::String>().Utf8Value();
+    if (newBackend != "pcap" && newBackend != "tpacket" && newBackend != "xdp") {
+      Napi::Error::New(info.Env(), "Unknown backend").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    backend = newBackend;
+  }
+  else {
+    obj.Set("backend", Napi::String::New(env, backend));
+  }
+
+  if (obj.Has("tpacketBlockSize")) {
+    tpacketConfig.blockSize = obj.Get("tpacketBlockSize").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("tpacketBlockSize", Napi::Number::New(env, tpacketConfig.blockSize));
+  }
+
+  if (obj.Has("tpacketBlockCount")) {
+    tpacketConfig.blockCount = obj.Get("tpacketBlockCount").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("tpacketBlockCount", Napi::Number::New(env, tpacketConfig.blockCount));
+  }
+
+  if (obj.Has("tpacketRetireTimeoutMs")) {
+    tpacketConfig.retireTimeoutMs = obj.Get("tpacketRetireTimeoutMs").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("tpacketRetireTimeoutMs", Napi::Number::New(env, tpacketConfig.retireTimeoutMs));
+  }
+
+  if (obj.Has("fanout") && obj.Get("fanout").IsObject()) {
+    Napi::Object fanout = obj.Get("fanout").As<Napi::Object>();
+    std::string mode = fanout.Has("mode") ? fanout.Get("mode").As<Napi::String>().Utf8Value() : "hash";
+    auto it = fanoutModes.find(mode);
+    if (it == fanoutModes.end()) {
+      Napi::Error::New(info.Env(), "Unknown fanout mode").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    // anything else would end up in another group
+    Napi::Value id = fanout.Get("id");
+    if (!id.IsNumber()) {
+      Napi::TypeError::New(info.Env(), "Fanout id must be a number").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    double idValue = id.As<Napi::Number>().DoubleValue();
+    if (!(idValue >= 0 && idValue <= 0xffff) || idValue != static_cast<uint16_t>(idValue)) {
+      Napi::RangeError::New(info.Env(), "Fanout id must be an integer between 0 and 65535").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    tpacketConfig.fanoutMode = it->second;
+    tpacketConfig.fanoutId = static_cast<uint16_t>(idValue);
+    tpacketConfig.fanoutDefrag = fanout.Has("defrag") && fanout.Get("defrag").ToBoolean();
+  }
+  else {
+    tpacketConfig.fanoutMode = -1;
+  }
+
+  if (obj.Has("xdpQueue")) {
+    xdpConfig.queueId = obj.Get("xdpQueue").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("xdpQueue", Napi::Number::New(env, xdpConfig.queueId));
+  }
+
+  if (obj.Has("xdpMode")) {
+    std::string mode = obj.Get("xdpMode").As<Napi::String>().Utf8Value();
+    if (mode == "copy") {
+      xdpConfig.zeroCopy = false;
+    }
+    else if (mode == "zerocopy") {
+      xdpConfig.zeroCopy = true;
+    }
+    else {
+      Napi::Error::New(info.Env(), "Unknown xdpMode").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+  else {
+    obj.Set("xdpMode", Napi::String::New(env, xdpConfig.zeroCopy ? "zerocopy" : "copy"));
+  }
+
+  if (obj.Has("xdpFrameSize")) {
+    xdpConfig.frameSize = obj.Get("xdpFrameSize").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("xdpFrameSize", Napi::Number::New(env, xdpConfig.frameSize));
+  }
+
+  if (obj.Has("xdpRingSize")) {
+    xdpConfig.ringSize = obj.Get("xdpRingSize").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("xdpRingSize", Napi::Number::New(env, xdpConfig.ringSize));
+  }
+
+  if (obj.Has("queueHighWatermark")) {
+    queueConfig.highWatermark = obj.Get("queueHighWatermark").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("queueHighWatermark", Napi::Number::New(env, queueConfig.highWatermark));
+  }
+
+  if (obj.Has("queueLowWatermark")) {
+    queueConfig.lowWatermark = obj.Get("queueLowWatermark").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("queueLowWatermark", Napi::Number::New(env, queueConfig.lowWatermark));
+  }
+
+  if (obj.Has("queueDropPolicy")) {
+    std::string policy = obj.Get("queueDropPolicy").As<Napi::String>().Utf8Value();
+    if (policy == "drop-newest") {
+      queueConfig.policy = DropPolicy::newest;
+    }
+    else if (policy == "drop-oldest") {
+      queueConfig.policy = DropPolicy::oldest;
+    }
+    else {
+      Napi::Error::New(info.Env(), "Unknown queueDropPolicy").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+  else {
+    obj.Set("queueDropPolicy", Napi::String::New(env, queueConfig.policy == DropPolicy::newest ? "drop-newest" : "drop-oldest"));
+  }
+
+  if (queueConfig.lowWatermark > queueConfig.highWatermark) {
+    queueConfig.lowWatermark = queueConfig.highWatermark;
+  }
+  if (queue) {
+    queue->configure(queueConfig);
+  }
+
+  if (obj.Has("record") && obj.Get("record").IsObject()) {
+    Napi::Object record = obj.Get("record").As<Napi::Object>();
+    recorderConfig = RecorderConfig{};
+    recorderConfig.path = record.Get("path").As<Napi::String>().Utf8Value();
+    if (record.Has("format")) {
+      recorderConfig.format = record.Get("format").As<Napi::String>().Utf8Value();
+    }
+    if (record.Has("rotateBytes")) {
+      recorderConfig.rotateBytes = record.Get("rotateBytes").As<Napi::Number>().Int64Value();
+    }
+    if (record.Has("rotateSeconds")) {
+      recorderConfig.rotateSeconds = record.Get("rotateSeconds").As<Napi::Number>().Int64Value();
+    }
+    if (record.Has("rotatePackets")) {
+      recorderConfig.rotatePackets = record.Get("rotatePackets").As<Napi::Number>().Int64Value();
+    }
+    if (record.Has("bufferSize")) {
+      recorderConfig.bufferSize = record.Get("bufferSize").As<Napi::Number>().Uint32Value();
+    }
+  }
+  else {
+    recorderConfig = RecorderConfig{};
+  }
+
+  if (obj.Has("txBackend")) {
+    std::string newTxBackend = obj.Get("txBackend").As<Napi::String>().Utf8Value();
+    if (newTxBackend != "pcap" && newTxBackend != "sendmmsg") {
+      Napi::Error::New(info.Env(), "Unknown txBackend").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    txBackend = newTxBackend;
+  }
+  else {
+    obj.Set("txBackend", Napi::String::New(env, txBackend));
+  }
+
+  if (obj.Has("txQdiscBypass")) {
+    txQdiscBypass = obj.Get("txQdiscBypass").ToBoolean();
+  }
+  else {
+    obj.Set("txQdiscBypass", Napi::Boolean::New(env, txQdiscBypass));
+  }
+
+  // the transmit ring is created with the device, later changes are ignored
+  if (obj.Has("txQueueSize")) {
+    txQueueSize = obj.Get("txQueueSize").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("txQueueSize", Napi::Number::New(env, txQueueSize));
+  }
+
+  if (obj.Has("batchSize")) {
+    batchConfig.packets = obj.Get("batchSize").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("batchSize", Napi::Number::New(env, batchConfig.packets));
+  }
+
+  if (obj.Has("batchTimeoutUs")) {
+    batchConfig.timeoutUs = obj.Get("batchTimeoutUs").As<Napi::Number>().Uint32Value();
+  }
+  else {
+    obj.Set("batchTimeoutUs", Napi::Number::New(env, batchConfig.timeoutUs));
+  }
+
   return info.Env().Undefined();
 }
 
 void PcapDevice::_destroy_impl() {
   DEBUG_OUTPUT("_destroy_impl");
+  for (auto* replay : std::set<Replay*>{replays}) {
+    replay->halt();
+  }
+  if (hasTx) {
+    // sends what was already written, the callbacks still run from the pending call
+    transmitter->stop();
+    transmitter->setSchedule(nullptr);
+    transmitter = nullptr;
+    tx.Release();
+  }
+
   if (dev && dev.get()) {
-    if (dev->captureActive()) {
-      dev->stopCapture();
-    }
+    stopCapture();
     DEBUG_OUTPUT("close");
-    dev->close();
+    if (tpacket || xdp) {
+      tpacket.reset();
+      xdp.reset();
+    }
+    else {
+      injector.reset();
+      dev->close();
+    }
   }
 
   if (hasPush) {
+    // pending calls find the queue paused and empty-handed, the finalizer deletes it
+    queue->pause();
+    queue->setSchedule(nullptr);
+    queue = nullptr;
     push.Release();
   }
+  if (hasEvents) {
+    events.Release();
+  }
   destroyed = true;
 }
 
@@ -217,13 +718,6 @@ PcapDevice::~PcapDevice() {
   }
 }
 
-pcpp::RawPacket bufToPacket(Napi::Value&& input, timeval& tv, pcpp::LinkLayerType linkType) {
-  int size;
-  uint8_t* buf;
-  std::tie(buf, size) = toCxx(input);
-  return pcpp::RawPacket{ buf, size, tv, true, linkType };
-}
-
 timeval getTime() {
   struct timeval tv;
   gettimeofday(&tv, NULL);
@@ -232,27 +726,92 @@ timeval getTime() {
 
 Napi::Value PcapDevice::_write(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("_write");
+  return queueWrite(info, false);
+}
+
+Napi::Value PcapDevice::_inject(const Napi::CallbackInfo& info) {
+  DEBUG_OUTPUT("_inject");
+  return queueWrite(info, true);
+}
+
+Napi::Value PcapDevice::queueWrite(const Napi::CallbackInfo& info, bool reportAccepted) {
   checkLength(info, 2);
-  packets_t packets;
+  Napi::Env env = info.Env();
+  Napi::Function callback = info[1].As<Napi::Function>();
+
+  if (!transmitter) {
+    Napi::Error::New(env, "Device is destroyed").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
 
   auto tv = getTime();
   auto linkType = dev->getLinkType();
 
+  std::vector<Napi::Value> inputs;
   if (info[0].IsArray()) {
     Napi::Array ar = info[0].As<Napi::Array>();
     size_t n = ar.Length();
-    packets.resize(n);
+    inputs.reserve(n);
     for (size_t i{}; i < n; ++i) {
-      packets[i] = bufToPacket(ar.Get(i), tv, linkType);
+      inputs.push_back(ar.Get(i));
     }
   }
   else {
-    packets.push_back(bufToPacket(info[0].As<Napi::Value>(), tv, linkType));
+    inputs.push_back(info[0]);
   }
-  Napi::Function callback = info[1].As<Napi::Function>();
-  SendWorker* w = new SendWorker(dev, callback, std::move(packets));
-  w->Queue();
-  return info.Env().Undefined();
+
+  // reserved up front: RawPacket deep-copies on reallocation
+  auto job = std::make_unique<TxJob>();
+  job->packets.reserve(inputs.size());
+  job->pins.reserve(inputs.size());
+  for (auto& input : inputs) {
+    auto [buf, size] = toCxxView(input);
+    if (env.IsExceptionPending()) {
+      return env.Undefined();
+    }
+    job->packets.emplace_back(buf, static_cast<int>(size), tv, false, linkType);
+    job->pins.push_back(Napi::Persistent(input.As<Napi::Object>()));
+  }
+  job->callback = Napi::Persistent(callback);
+  job->reportAccepted = reportAccepted;
+
+  // the backend is known once the device is open
+  if (!transmitter->running()) {
+    transmitter->start(sender());
+  }
+
+  if (!transmitter->offer(job.get())) {
+    callback.Call({ Napi::Error::New(env, "Transmit queue is full").Value() });
+    return env.Undefined();
+  }
+  job.release();
+  return env.Undefined();
+}
+
+sender_t PcapDevice::sender() {
+  if (tpacket) {
+    // the TPacketCapture is destroyed after the transmit thread is stopped
+    auto* capture = tpacket.get();
+    return [capture](const pcpp::RawPacket* packets, int n) {
+      return capture->send(packets, n);
+    };
+  }
+  if (xdp) {
+    auto* socket = xdp.get();
+    return [socket](const pcpp::RawPacket* packets, int n) {
+      return socket->send(packets, n);
+    };
+  }
+  if (injector) {
+    auto* inj = injector.get();
+    return [inj](const pcpp::RawPacket* packets, int n) {
+      return inj->send(packets, n);
+    };
+  }
+  auto dev = this->dev;
+  return [dev](const pcpp::RawPacket* packets, int n) {
+    return dev->sendPackets(packets, n);
+  };
 }
 
 Napi::Value PcapDevice::interfaceInfo(const Napi::CallbackInfo& info) {
@@ -308,13 +867,63 @@ Napi::Value PcapDevice::stats(const Napi::CallbackInfo& info) {
     Napi::Error::New(env, "No device").ThrowAsJavaScriptException();
     return info.Env().Undefined();
   }
-  pcpp::IPcapDevice::PcapStats stats;
-  dev->getStatistics(stats);
-
   Napi::Object res = Napi::Object::New(env);
-  res.Set("packetsDrop", Napi::Number::New(env, stats.packetsDrop));
-  res.Set("packetsDropByInterface", Napi::Number::New(env, stats.packetsDropByInterface));
-  res.Set("packetsRecv", Napi::Number::New(env, stats.packetsRecv));
+
+  if (tpacket) {
+    auto stats = tpacket->ring->stats();
+    res.Set("packetsDrop", Napi::Number::New(env, stats.drops));
+    res.Set("packetsDropByInterface", Napi::Number::New(env, 0));
+    res.Set("packetsRecv", Napi::Number::New(env, stats.packets));
+    res.Set("ringDrops", Napi::Number::New(env, stats.drops));
+    res.Set("ringFreezes", Napi::Number::New(env, stats.freezes));
+    res.Set("ringStalls", Napi::Number::New(env, stats.stalls));
+  }
+  else if (xdp) {
+    auto stats = xdp->stats();
+    res.Set("packetsDrop", Napi::Number::New(env, stats.rxDropped + stats.rxRingFull));
+    res.Set("packetsDropByInterface", Napi::Number::New(env, 0));
+    res.Set("packetsRecv", Napi::Number::New(env, stats.rxPackets));
+    res.Set("packetsFiltered", Napi::Number::New(env, stats.rxFiltered));
+    res.Set("packetsSent", Napi::Number::New(env, stats.txPackets));
+    res.Set("ringFull", Napi::Number::New(env, stats.rxRingFull));
+    res.Set("fillRingEmpty", Napi::Number::New(env, stats.fillRingEmpty));
+    res.Set("invalidDescs", Napi::Number::New(env, stats.rxInvalid + stats.txInvalid));
+  }
+  else {
+    pcpp::IPcapDevice::PcapStats stats;
+    dev->getStatistics(stats);
+
+    res.Set("packetsDrop", Napi::Number::New(env, stats.packetsDrop));
+    res.Set("packetsDropByInterface", Napi::Number::New(env, stats.packetsDropByInterface));
+    res.Set("packetsRecv", Napi::Number::New(env, stats.packetsRecv));
+  }
+
+  if (ring) {
+    res.Set("ringDropped", Napi::Number::New(env, ring->dropped()));
+  }
+
+  if (recorder) {
+    auto stats = recorder->stats();
+    res.Set("recordedPackets", Napi::Number::New(env, stats.packets));
+    res.Set("recordedBytes", Napi::Number::New(env, stats.bytes));
+    res.Set("recordedFiles", Napi::Number::New(env, stats.files));
+    res.Set("recordErrors", Napi::Number::New(env, stats.errors));
+  }
+
+  if (queue) {
+    auto stats = queue->stats();
+    res.Set("queueDropped", Napi::Number::New(env, stats.dropped));
+    res.Set("queueDepth", Napi::Number::New(env, stats.depth));
+  }
+
+  if (transmitter) {
+    auto stats = transmitter->stats();
+    res.Set("txQueueDepth", Napi::Number::New(env, stats.depth));
+    res.Set("txPackets", Napi::Number::New(env, stats.packets));
+    res.Set("txErrors", Napi::Number::New(env, stats.errors));
+    res.Set("txLatencyAvgUs", Napi::Number::New(env, stats.latencyAvgUs));
+    res.Set("txLatencyMaxUs", Napi::Number::New(env, stats.latencyMaxUs));
+  }
 
   return res;
 }
@@ -322,7 +931,22 @@ Napi::Value PcapDevice::stats(const Napi::CallbackInfo& info) {
 Napi::Value PcapDevice::setFilter(const Napi::CallbackInfo& info) {
   DEBUG_OUTPUT("setFilter");
   checkLength(info, 1);
-  if (dev && dev.get()) {
+  if (tpacket || xdp) {
+    std::string filter = info[0].As<Napi::String>().Utf8Value();
+    std::string err;
+    auto program = BpfFilter::FilterCache::instance().get(filter, pcpp::LINKTYPE_ETHERNET, BpfFilter::defaultSnaplen, err);
+    if (!program) {
+      Napi::Error::New(info.Env(), "Could not set filter: " + err).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    // both copy the program, a view of the cached one is enough
+    bpf_program prog{(u_int)program->size(), const_cast<bpf_insn*>(program->data())};
+    err = tpacket ? tpacket->ring->attachFilter(prog) : xdp->attachFilter(prog);
+    if (err.size() > 0) {
+      Napi::Error::New(info.Env(), "Could not set filter: " + err).ThrowAsJavaScriptException();
+    }
+  }
+  else if (dev && dev.get()) {
     if (!dev->setFilter(info[0].As<Napi::String>().Utf8Value())) {
       Napi::Error::New(info.Env(), "Could not set filter").ThrowAsJavaScriptException();
     }
@@ -1,12 +1,22 @@
 #pragma once
 
 #include <iostream>
+#include <set>
+#include <variant>
 #include "common.hpp"
 #include "stdlib.h"
 #include "PcapLiveDeviceList.h"
 #include "IpUtils.h"
 #include "SystemUtils.h"
 #include "pcap.h"
+#include "PacketBatch.hpp"
+#include "CaptureRing.hpp"
+#include "DeliveryQueue.hpp"
+#include "Recorder.hpp"
+#include "Transmitter.hpp"
+#include "Injector.hpp"
+#include "TPacket.hpp"
+#include "transports/xdp/Xdp.hpp"
 
 /* PcapLiveDevice bindings that are specifically designed for 
  * the Duplex stream wrapper. Btw, the only way to send L2 packets
@@ -18,33 +28,35 @@
 namespace OverTheWire::Transports::Pcap {
   using device_t = pcpp::PcapLiveDevice;
   using device_ptr_t = std::shared_ptr<device_t>;
-  using Context = std::nullptr_t;
-  using DataType = pcpp::RawPacket;
+  using Context = DeliveryQueue;
+  using DataType = PacketBatch;
+  struct Replay;
   void CallJs(Napi::Env, Napi::Function, Context*, DataType*);
   using TSFN = Napi::TypedThreadSafeFunction<Context, DataType, CallJs>;
+
+  /* Anything the capture thread wants to tell JS besides the packets themselves.
+   */
+  struct DeviceEvent {
+    using field_t = std::pair<std::string, std::variant<double, std::string>>;
+    std::string name;
+    std::vector<field_t> fields;
+  };
+  using EventContext = std::nullptr_t;
+  void CallJsEvent(Napi::Env, Napi::Function, EventContext*, DeviceEvent*);
+  using EventTSFN = Napi::TypedThreadSafeFunction<EventContext, DeviceEvent, CallJsEvent>;
   using FinalizerDataType = void;
-  using packets_t = std::vector<pcpp::RawPacket>;
 
   Napi::Object Init(Napi::Env env, Napi::Object exports);
   void onPacketArrivesRaw(pcpp::RawPacket*, pcpp::PcapLiveDevice*, void*);
-  pcpp::RawPacket bufToPacket(js_buffer_t&&, timeval&);
   timeval getTime();
 
-  struct SendWorker : public Napi::AsyncWorker {
-    SendWorker(device_ptr_t, Napi::Function&, packets_t&&);
-    ~SendWorker();
-    void Execute() override;
-
-    device_ptr_t dev;
-    Napi::Function& callback;
-    packets_t packets;
-  };
-
   struct PcapDevice : public Napi::ObjectWrap<PcapDevice> {
     static Napi::Object Init(Napi::Env, Napi::Object);
     PcapDevice(const Napi::CallbackInfo& info);
     ~PcapDevice();
     Napi::Value _write(const Napi::CallbackInfo&);
+    Napi::Value _inject(const Napi::CallbackInfo&);
+    Napi::Value queueWrite(const Napi::CallbackInfo&, bool);
     Napi::Value interfaceInfo(const Napi::CallbackInfo& info);
     Napi::Value stats(const Napi::CallbackInfo& info);
     Napi::Value setFilter(const Napi::CallbackInfo& info);
@@ -52,14 +64,48 @@ namespace OverTheWire::Transports::Pcap {
     Napi::Value open(const Napi::CallbackInfo& info);
     Napi::Value startCapture(const Napi::CallbackInfo& info);
     Napi::Value stopCapture(const Napi::CallbackInfo& info);
+    Napi::Value resume(const Napi::CallbackInfo& info);
+    Napi::Value attachRing(const Napi::CallbackInfo& info);
     Napi::Value _destroy(const Napi::CallbackInfo&);
 
+    void ingest(const uint8_t*, uint32_t, uint32_t, const timespec&);
+    void emitEvent(DeviceEvent*);
+    void stopCapture();
+    std::string startRecorder();
+    sender_t sender();
+
     bool destroyed = false;
     void _destroy_impl();
+    // they send through the backend from threads of their own
+    std::set<Replay*> replays;
 
     pcpp::PcapLiveDevice::DeviceConfiguration config;
+    BatchConfig batchConfig;
+    QueueConfig queueConfig;
+    RecorderConfig recorderConfig;
+    std::unique_ptr<Recorder> recorder;
+    std::string backend = "pcap";
+    TPacketConfig tpacketConfig;
+    std::unique_ptr<TPacketCapture> tpacket;
+    Xdp::XdpConfig xdpConfig;
+    std::unique_ptr<Xdp::XdpSocket> xdp;
+    std::string txBackend = "pcap";
+    bool txQdiscBypass = false;
+    std::unique_ptr<Injector> injector;
+    std::unique_ptr<Batcher> batcher;
     device_ptr_t dev;
     bool hasPush = false;
     TSFN push;
+    // owned by the push TSFN, deleted by its finalizer
+    DeliveryQueue* queue = nullptr;
+    bool hasEvents = false;
+    EventTSFN events;
+    size_t txQueueSize = 1024;
+    bool hasTx = false;
+    TxTSFN tx;
+    // owned by the tx TSFN, deleted by its finalizer
+    Transmitter* transmitter = nullptr;
+    std::unique_ptr<CaptureRing> ring;
+    Napi::Reference<Napi::Value> ringRef;
   };
 }
@@ -0,0 +1,233 @@
+#include "Recorder.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <iomanip>
+
+namespace OverTheWire::Transports::Pcap {
+
+// both formats are written in host byte order, readers detect it by the magic
+static const uint32_t pcapMagicNano = 0xa1b23c4d;
+static const uint32_t pcapngSectionHeader = 0x0a0d0d0a;
+static const uint32_t pcapngInterfaceDescription = 1;
+static const uint32_t pcapngEnhancedPacket = 6;
+static const uint32_t pcapngByteOrderMagic = 0x1a2b3c4d;
+
+#pragma pack(push, 1)
+struct PcapFileHeader {
+  uint32_t magic;
+  uint16_t major, minor;
+  int32_t thiszone;
+  uint32_t sigfigs, snaplen, linkType;
+};
+
+struct PcapngSectionHeader {
+  uint32_t type, length, magic;
+  uint16_t major, minor;
+  int64_t sectionLength;
+  uint32_t trailer;
+};
+
+struct PcapngInterfaceDescription {
+  uint32_t type, length;
+  uint16_t linkType, reserved;
+  uint32_t snaplen;
+  uint16_t tsresolCode, tsresolLength;
+  uint8_t tsresol, pad[3];
+  uint16_t endCode, endLength;
+  uint32_t trailer;
+};
+#pragma pack(pop)
+
+static uint32_t pad4(uint32_t v) {
+  return (v + 3) & ~uint32_t{3};
+}
+
+Recorder::Recorder(const RecorderConfig& config, on_rotate_t onRotate, on_error_t onError) :
+  config{config}, onRotate{onRotate}, onError{onError} {}
+
+Recorder::~Recorder() {
+  close();
+}
+
+std::string Recorder::fileName(uint64_t idx) {
+  if (!config.rotates()) {
+    return config.path;
+  }
+
+  std::string stem = config.path;
+  std::string ext;
+  auto dot = config.path.find_last_of('.');
+  auto slash = config.path.find_last_of("/\\");
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+    stem = config.path.substr(0, dot);
+    ext = config.path.substr(dot);
+  }
+
+  std::stringstream ss;
+  ss << stem << "-" << std::setw(5) << std::setfill('0') << idx << ext;
+  return ss.str();
+}
+
+std::string Recorder::open() {
+  if (config.format != "pcap" && config.format != "pcapng") {
+    return "Unknown format " + config.format;
+  }
+  pcapng = config.format == "pcapng";
+  index = config.firstIndex;
+  return openFile();
+}
+
+std::string Recorder::openFile() {
+  currentPath = fileName(index);
+  bool append = config.append && !config.rotates();
+  file = std::fopen(currentPath.c_str(), append ? "ab" : "wb");
+  if (!file) {
+    return currentPath + ": " + std::strerror(errno);
+  }
+  // the same device writes the same header, the records go on after the old ones
+  bool hasHeader = append && std::fseek(file, 0, SEEK_END) == 0 && std::ftell(file) > 0;
+
+  buffer.resize(config.bufferSize);
+  std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+  filePackets = 0;
+  fileBytes = 0;
+  openedAt = std::chrono::steady_clock::now();
+  files.fetch_add(1, std::memory_order_relaxed);
+
+  if (!hasHeader && !writeHeader()) {
+    return currentPath + ": " + std::strerror(errno);
+  }
+  return "";
+}
+
+bool Recorder::writeHeader() {
+  if (!pcapng) {
+    PcapFileHeader hdr{ pcapMagicNano, 2, 4, 0, 0, config.snaplen, config.linkType };
+    fileBytes += sizeof(hdr);
+    return std::fwrite(&hdr, sizeof(hdr), 1, file) == 1;
+  }
+
+  PcapngSectionHeader shb{ pcapngSectionHeader, sizeof(shb), pcapngByteOrderMagic, 1, 0, -1, sizeof(shb) };
+  // if_tsresol = 9, nanoseconds
+  PcapngInterfaceDescription idb{
+    pcapngInterfaceDescription, sizeof(idb), static_cast<uint16_t>(config.linkType), 0, config.snaplen,
+    9, 1, 9, {}, 0, 0, sizeof(idb)
+  };
+
+  fileBytes += sizeof(shb) + sizeof(idb);
+  return std::fwrite(&shb, sizeof(shb), 1, file) == 1 && std::fwrite(&idb, sizeof(idb), 1, file) == 1;
+}
+
+bool Recorder::shouldRotate(size_t recordSize) {
+  if (!config.rotates() || filePackets == 0) {
+    return false;
+  }
+  if (config.rotatePackets > 0 && filePackets >= config.rotatePackets) {
+    return true;
+  }
+  if (config.rotateBytes > 0 && fileBytes + recordSize > config.rotateBytes) {
+    return true;
+  }
+  // checked per packet, an idle interface keeps its file open
+  if (config.rotateSeconds > 0 && std::chrono::steady_clock::now() - openedAt >= std::chrono::seconds(config.rotateSeconds)) {
+    return true;
+  }
+  return false;
+}
+
+void Recorder::rotate() {
+  std::string closedPath = currentPath;
+  uint64_t closedIndex = index;
+  uint64_t closedPackets = filePackets;
+  uint64_t closedBytes = fileBytes;
+
+  std::fclose(file);
+  file = nullptr;
+
+  ++index;
+  auto err = openFile();
+  if (onRotate) {
+    onRotate(closedPath, closedIndex, closedPackets, closedBytes);
+  }
+  if (err.size() > 0) {
+    fail(err);
+  }
+}
+
+void Recorder::fail(const std::string& err) {
+  errors.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    return;
+  }
+  // stop writing, a full disk would fail every packet the same way
+  failed = true;
+  if (onError) {
+    onError(err);
+  }
+}
+
+void Recorder::write(const uint8_t* buf, uint32_t len, uint32_t origLen, const timespec& ts) {
+  if (failed || !file) {
+    return;
+  }
+
+  len = std::min(len, config.snaplen);
+  size_t recordSize = pcapng ? 32 + pad4(len) : 16 + len;
+
+  if (shouldRotate(recordSize)) {
+    rotate();
+    if (failed) {
+      return;
+    }
+  }
+
+  bool ok;
+  if (!pcapng) {
+    uint32_t hdr[4] = { static_cast<uint32_t>(ts.tv_sec), static_cast<uint32_t>(ts.tv_nsec), len, origLen };
+    ok = std::fwrite(hdr, sizeof(hdr), 1, file) == 1 && std::fwrite(buf, 1, len, file) == len;
+  }
+  else {
+    uint64_t tsNs = uint64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    uint32_t total = static_cast<uint32_t>(recordSize);
+    uint32_t hdr[7] = { pcapngEnhancedPacket, total, 0, static_cast<uint32_t>(tsNs >> 32), static_cast<uint32_t>(tsNs), len, origLen };
+    static const uint8_t zeros[4] = {};
+    ok = std::fwrite(hdr, sizeof(hdr), 1, file) == 1 &&
+      std::fwrite(buf, 1, len, file) == len &&
+      std::fwrite(zeros, 1, pad4(len) - len, file) == pad4(len) - len &&
+      std::fwrite(&total, sizeof(total), 1, file) == 1;
+  }
+
+  if (!ok) {
+    fail(currentPath + ": " + std::strerror(errno));
+    return;
+  }
+
+  ++filePackets;
+  fileBytes += recordSize;
+  packets.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(recordSize, std::memory_order_relaxed);
+}
+
+void Recorder::close() {
+  if (file) {
+    std::fclose(file);
+    file = nullptr;
+    // the last file is finished too
+    if (config.rotates() && onRotate) {
+      onRotate(currentPath, index, filePackets, fileBytes);
+    }
+  }
+}
+
+RecorderStats Recorder::stats() {
+  return {
+    packets.load(std::memory_order_relaxed),
+    bytes.load(std::memory_order_relaxed),
+    files.load(std::memory_order_relaxed),
+    errors.load(std::memory_order_relaxed),
+  };
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <functional>
+
+#include "common.hpp"
+
+/* Writes captured packets straight to pcap or pcapng files on the capture
+ * thread, nothing goes through JS. Output is buffered by stdio with a big
+ * buffer, timestamps are always in nanoseconds. With any rotate* limit set
+ * the files are named <stem>-<index><ext> and JS is told about every file
+ * that was finished, the last one included. A restarted capture never
+ * writes over the files of the previous one.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  struct RecorderConfig {
+    std::string path;
+    std::string format = "pcap";
+    uint64_t rotateBytes = 0;
+    uint64_t rotateSeconds = 0;
+    uint64_t rotatePackets = 0;
+    size_t bufferSize = 1 << 20;
+    uint32_t snaplen = 65535;
+    uint32_t linkType = 1;
+    // where a restarted capture goes on: the next rotated file, or the end of the single one
+    uint64_t firstIndex = 0;
+    bool append = false;
+
+    bool enabled() const { return path.size() > 0; }
+    bool rotates() const { return rotateBytes > 0 || rotateSeconds > 0 || rotatePackets > 0; }
+  };
+
+  struct RecorderStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t files = 0;
+    uint64_t errors = 0;
+  };
+
+  struct Recorder {
+    // path, index, packets and bytes of a file that was just closed
+    using on_rotate_t = std::function<void(const std::string&, uint64_t, uint64_t, uint64_t)>;
+    using on_error_t = std::function<void(const std::string&)>;
+
+    Recorder(const RecorderConfig&, on_rotate_t, on_error_t);
+    ~Recorder();
+
+    std::string open();
+    void write(const uint8_t*, uint32_t, uint32_t, const timespec&);
+    void close();
+    RecorderStats stats();
+
+    std::string fileName(uint64_t);
+    std::string openFile();
+    bool writeHeader();
+    bool shouldRotate(size_t);
+    void rotate();
+    void fail(const std::string&);
+
+    RecorderConfig config;
+    on_rotate_t onRotate;
+    on_error_t onError;
+
+    bool pcapng = false;
+    std::FILE* file = nullptr;
+    std::vector<char> buffer;
+    std::string currentPath;
+    uint64_t index = 0;
+    uint64_t filePackets = 0;
+    uint64_t fileBytes = 0;
+    std::chrono::steady_clock::time_point openedAt;
+    bool failed = false;
+
+    std::atomic<uint64_t> packets = 0;
+    std::atomic<uint64_t> bytes = 0;
+    std::atomic<uint64_t> files = 0;
+    std::atomic<uint64_t> errors = 0;
+  };
+}
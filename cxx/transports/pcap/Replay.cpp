@@ -0,0 +1,371 @@
+#include "Replay.hpp"
+
+namespace OverTheWire::Transports::Pcap {
+
+// waits shorter than this are spun, longer ones are slept in slices so stop() is noticed
+static const auto spinThreshold = std::chrono::microseconds(200);
+static const auto maxSleep = std::chrono::milliseconds(100);
+
+static const std::map<std::string, PacingMode> pacingModes = {
+  { "original", PacingMode::original },
+  { "multiplier", PacingMode::multiplier },
+  { "pps", PacingMode::pps },
+  { "mbps", PacingMode::mbps },
+  { "topspeed", PacingMode::topspeed },
+};
+
+Napi::Object Replay::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "Replay", {
+    InstanceMethod<&Replay::start>("start", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&Replay::stop>("stop", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceAccessor<&Replay::stats>("stats"),
+  });
+
+  env.GetInstanceData<AddonData>()->SetClass(typeid(Replay), func);
+  exports.Set("Replay", func);
+  return exports;
+}
+
+Replay::Replay(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Replay>{info} {
+  checkLength(info, 1);
+  Napi::Env env = info.Env();
+  Napi::Object obj = info[0].As<Napi::Object>();
+
+  if (!obj.Has("path") || !obj.Get("path").IsString()) {
+    Napi::Error::New(env, "File path is required").ThrowAsJavaScriptException();
+    return;
+  }
+  config.path = obj.Get("path").As<Napi::String>().Utf8Value();
+
+  if (!obj.Has("target") || !obj.Get("target").IsObject()) {
+    Napi::Error::New(env, "Target is required").ThrowAsJavaScriptException();
+    return;
+  }
+  targetRef = Napi::Persistent(obj.Get("target").As<Napi::Object>());
+
+  if (obj.Has("mode")) {
+    auto it = pacingModes.find(obj.Get("mode").As<Napi::String>().Utf8Value());
+    if (it == pacingModes.end()) {
+      Napi::Error::New(env, "Unknown mode").ThrowAsJavaScriptException();
+      return;
+    }
+    config.mode = it->second;
+  }
+
+  if (obj.Has("multiplier")) {
+    config.multiplier = obj.Get("multiplier").As<Napi::Number>().DoubleValue();
+  }
+  if (obj.Has("pps")) {
+    config.pps = obj.Get("pps").As<Napi::Number>().DoubleValue();
+  }
+  if (obj.Has("mbps")) {
+    config.mbps = obj.Get("mbps").As<Napi::Number>().DoubleValue();
+  }
+  if (obj.Has("loop")) {
+    config.loop = obj.Get("loop").As<Napi::Number>().Int64Value();
+  }
+  if (obj.Has("batchSize")) {
+    config.batchSize = std::max<uint32_t>(obj.Get("batchSize").As<Napi::Number>().Uint32Value(), 1);
+  }
+
+  if ((config.mode == PacingMode::multiplier && config.multiplier <= 0) ||
+      (config.mode == PacingMode::pps && config.pps <= 0) ||
+      (config.mode == PacingMode::mbps && config.mbps <= 0)) {
+    Napi::Error::New(env, "The rate of the chosen mode must be positive").ThrowAsJavaScriptException();
+    return;
+  }
+}
+
+Replay::~Replay() {
+  // start() holds a reference until CallJs, so the thread is done by now
+  halt();
+}
+
+void Replay::halt() {
+  stopping = true;
+  if (thread.joinable()) {
+    thread.join();
+  }
+  detach();
+}
+
+void Replay::detach() {
+  if (device) {
+    device->replays.erase(this);
+    device = nullptr;
+  }
+  if (socket) {
+    socket->replays.erase(this);
+    socket = nullptr;
+  }
+}
+
+Napi::Value Replay::start(const Napi::CallbackInfo& info) {
+  DEBUG_OUTPUT("Replay::start");
+  Napi::Env env = info.Env();
+  // the promise of the last run is settled once CallJs ran, after the thread is over
+  if (running || deferred) {
+    Napi::Error::New(env, "Replay is already running").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // resolved here and not in the constructor: the backend is known once the device is open
+  auto* data = env.GetInstanceData<AddonData>();
+  Napi::Object target = targetRef.Value();
+  if (data->HasClass(typeid(PcapDevice)) && target.InstanceOf(data->GetClass(typeid(PcapDevice)).Value())) {
+    auto* dev = Napi::ObjectWrap<PcapDevice>::Unwrap(target);
+    if (dev->destroyed) {
+      Napi::Error::New(env, "Device is destroyed").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    send = dev->sender();
+    device = dev;
+    device->replays.insert(this);
+  }
+  else if (data->HasClass(typeid(Socket::Socket)) && target.InstanceOf(data->GetClass(typeid(Socket::Socket)).Value())) {
+    auto* sock = Napi::ObjectWrap<Socket::Socket>::Unwrap(target);
+    if (sock->closed) {
+      Napi::Error::New(env, "Socket is closed").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    SOCKET fd = sock->pollfd;
+    send = [fd](const pcpp::RawPacket* packets, int n) {
+      return sendFrames(fd, packets, n);
+    };
+    socket = sock;
+    socket->replays.insert(this);
+  }
+  else {
+    Napi::Error::New(env, "Expected a PcapDevice or a Socket as target").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (thread.joinable()) {
+    thread.join();
+  }
+
+  packets = 0;
+  bytes = 0;
+  failed = 0;
+  loops = 0;
+  timingErrorSumNs = 0;
+  timingErrorMaxNs = 0;
+  stopping = false;
+  running = true;
+
+  deferred = std::make_shared<Napi::Promise::Deferred>(Napi::Promise::Deferred::New(env));
+  done = TSFN::New(env, "replay", 0, 1, this);
+  // keeps this object (and the target) alive while the thread runs
+  Ref();
+
+  startedAt = clock_t::now();
+  thread = std::thread{&Replay::main, this};
+  return deferred->Promise();
+}
+
+Napi::Value Replay::stop(const Napi::CallbackInfo& info) {
+  DEBUG_OUTPUT("Replay::stop");
+  stopping = true;
+  return info.Env().Undefined();
+}
+
+void Replay::CallJs(Napi::Env env, Napi::Function, Replay* self, CallJsData* data) {
+  std::unique_ptr<CallJsData> err{data};
+  if (env == nullptr) {
+    return;
+  }
+
+  if (self->thread.joinable()) {
+    self->thread.join();
+  }
+  self->detach();
+
+  auto deferred = std::move(self->deferred);
+  if (err->size() > 0) {
+    deferred->Reject(Napi::Error::New(env, *err).Value());
+  }
+  else {
+    deferred->Resolve(self->statsObject(env));
+  }
+  self->Unref();
+}
+
+void Replay::main() {
+  DEBUG_OUTPUT("Replay::main");
+  clock_t::time_point next = startedAt;
+  std::string err;
+
+  for (uint64_t i{}; (config.loop == 0 || i < config.loop) && !stopping; ++i) {
+    uint64_t before = packets + failed;
+    err = runOnce(next);
+    if (err.size() > 0) {
+      break;
+    }
+    loops.fetch_add(1, std::memory_order_relaxed);
+    if (packets + failed == before) {
+      // an empty file would loop forever
+      break;
+    }
+  }
+
+  finishedAt = clock_t::now();
+  running = false;
+  done.BlockingCall(new CallJsData{err});
+  done.Release();
+}
+
+std::string Replay::runOnce(clock_t::time_point& next) {
+  std::unique_ptr<pcpp::IFileReaderDevice> reader{pcpp::IFileReaderDevice::getReader(config.path)};
+  if (!reader || !reader->open()) {
+    return "Could not open " + config.path;
+  }
+
+  // twice the batch so a packet that has to wait can stay where it was read
+  std::vector<pcpp::RawPacket> window(config.batchSize * 2);
+  std::vector<clock_t::time_point> due(window.size());
+  size_t begin = 0;
+  size_t end = 0;
+
+  bool first = true;
+  timespec firstTs{};
+  clock_t::time_point loopStart = next;
+  double speed = config.mode == PacingMode::multiplier ? config.multiplier : 1;
+
+  while (!stopping) {
+    if (end == window.size()) {
+      flush(window, begin, end, due);
+      begin = end = 0;
+    }
+
+    auto& packet = window[end];
+    if (!reader->getNextPacket(packet)) {
+      break;
+    }
+
+    clock_t::time_point target;
+    switch (config.mode) {
+      case PacingMode::original:
+      case PacingMode::multiplier: {
+        auto ts = packet.getPacketTimeStamp();
+        if (first) {
+          firstTs = ts;
+          first = false;
+        }
+        double offsetNs = double(ts.tv_sec - firstTs.tv_sec) * 1e9 + double(ts.tv_nsec - firstTs.tv_nsec);
+        target = loopStart + std::chrono::nanoseconds(static_cast<int64_t>(std::max(offsetNs, 0.0) / speed));
+        next = target;
+        break;
+      }
+      case PacingMode::pps:
+        target = next;
+        next += std::chrono::nanoseconds(static_cast<int64_t>(1e9 / config.pps));
+        break;
+      case PacingMode::mbps:
+        target = next;
+        next += std::chrono::nanoseconds(static_cast<int64_t>(packet.getRawDataLen() * 8 * 1e3 / config.mbps));
+        break;
+      case PacingMode::topspeed:
+        target = clock_t::now();
+        break;
+    }
+    due[end] = target;
+
+    if (target > clock_t::now()) {
+      // everything before it is due already
+      flush(window, begin, end, due);
+      begin = end;
+      waitUntil(target);
+    }
+    ++end;
+
+    if (end - begin >= config.batchSize) {
+      flush(window, begin, end, due);
+      begin = end;
+    }
+  }
+
+  flush(window, begin, end, due);
+  // in the next loop the first packet goes out right after the last one of this loop
+  next = std::max(next, clock_t::now());
+  reader->close();
+  return "";
+}
+
+void Replay::waitUntil(clock_t::time_point target) {
+  while (!stopping) {
+    auto now = clock_t::now();
+    if (now >= target) {
+      return;
+    }
+    auto left = target - now;
+    if (left > spinThreshold) {
+      std::this_thread::sleep_for(std::min<clock_t::duration>(left - spinThreshold, maxSleep));
+    }
+  }
+}
+
+void Replay::flush(std::vector<pcpp::RawPacket>& window, size_t begin, size_t end, const std::vector<clock_t::time_point>& due) {
+  if (begin == end) {
+    return;
+  }
+
+  auto now = clock_t::now();
+  uint64_t errSum = 0;
+  uint64_t errMax = timingErrorMaxNs.load(std::memory_order_relaxed);
+  for (size_t i = begin; i < end; ++i) {
+    auto diff = now > due[i] ? now - due[i] : due[i] - now;
+    uint64_t err = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+    errSum += err;
+    errMax = std::max(errMax, err);
+  }
+
+  int accepted = send(&window[begin], static_cast<int>(end - begin));
+  uint64_t sentBytes = 0;
+  for (size_t i = begin; i < begin + accepted; ++i) {
+    sentBytes += window[i].getRawDataLen();
+  }
+
+  packets.fetch_add(accepted, std::memory_order_relaxed);
+  bytes.fetch_add(sentBytes, std::memory_order_relaxed);
+  failed.fetch_add(end - begin - accepted, std::memory_order_relaxed);
+  timingErrorSumNs.fetch_add(errSum, std::memory_order_relaxed);
+  // only this thread writes it
+  timingErrorMaxNs.store(errMax, std::memory_order_relaxed);
+}
+
+ReplayStats Replay::snapshot() {
+  auto to = running ? clock_t::now() : finishedAt;
+  uint64_t sent = packets.load(std::memory_order_relaxed);
+  uint64_t total = sent + failed.load(std::memory_order_relaxed);
+  return {
+    sent,
+    bytes.load(std::memory_order_relaxed),
+    failed.load(std::memory_order_relaxed),
+    loops.load(std::memory_order_relaxed),
+    std::chrono::duration<double>(to - startedAt).count(),
+    total > 0 ? timingErrorSumNs.load(std::memory_order_relaxed) / 1e3 / total : 0,
+    timingErrorMaxNs.load(std::memory_order_relaxed) / 1e3,
+  };
+}
+
+Napi::Object Replay::statsObject(Napi::Env env) {
+  auto stats = snapshot();
+  Napi::Object res = Napi::Object::New(env);
+  res.Set("packets", Napi::Number::New(env, stats.packets));
+  res.Set("bytes", Napi::Number::New(env, stats.bytes));
+  res.Set("failed", Napi::Number::New(env, stats.failed));
+  res.Set("loops", Napi::Number::New(env, stats.loops));
+  res.Set("elapsedSec", Napi::Number::New(env, stats.elapsedSec));
+  res.Set("pps", Napi::Number::New(env, stats.elapsedSec > 0 ? stats.packets / stats.elapsedSec : 0));
+  res.Set("mbps", Napi::Number::New(env, stats.elapsedSec > 0 ? stats.bytes * 8 / stats.elapsedSec / 1e6 : 0));
+  res.Set("timingErrorAvgUs", Napi::Number::New(env, stats.timingErrorAvgUs));
+  res.Set("timingErrorMaxUs", Napi::Number::New(env, stats.timingErrorMaxUs));
+  res.Set("running", Napi::Boolean::New(env, running));
+  return res;
+}
+
+Napi::Value Replay::stats(const Napi::CallbackInfo& info) {
+  return statsObject(info.Env());
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "common.hpp"
+#include "PcapFileDevice.h"
+#include "Pcap.hpp"
+#include "Injector.hpp"
+#include "transports/socket/Socket.hpp"
+
+/* tcpreplay-style replay of a pcap/pcapng file. The file is read and the
+ * packets are sent on a thread of its own, through a PcapDevice (whatever
+ * backend it uses) or straight on the fd of a raw Socket. Frames that are
+ * due at the same time go out in one send call, the last few microseconds
+ * of every wait are spun instead of slept.
+ *
+ * The target knows its running replays and halts them before it closes.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  enum class PacingMode { original, multiplier, pps, mbps, topspeed };
+
+  struct ReplayConfig {
+    std::string path;
+    PacingMode mode = PacingMode::original;
+    double multiplier = 1;
+    double pps = 0;
+    double mbps = 0;
+    // 0 loops forever
+    uint64_t loop = 1;
+    size_t batchSize = 64;
+  };
+
+  struct ReplayStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t failed = 0;
+    uint64_t loops = 0;
+    double elapsedSec = 0;
+    double timingErrorAvgUs = 0;
+    double timingErrorMaxUs = 0;
+  };
+
+  struct Replay : public Napi::ObjectWrap<Replay> {
+    using clock_t = std::chrono::steady_clock;
+    using CallJsData = std::string;
+    static void CallJs(Napi::Env, Napi::Function, Replay*, CallJsData*);
+    using TSFN = Napi::TypedThreadSafeFunction<Replay, CallJsData, CallJs>;
+
+    static Napi::Object Init(Napi::Env, Napi::Object);
+    Replay(const Napi::CallbackInfo&);
+    ~Replay();
+
+    Napi::Value start(const Napi::CallbackInfo&);
+    Napi::Value stop(const Napi::CallbackInfo&);
+    Napi::Value stats(const Napi::CallbackInfo&);
+
+    // stops the thread and forgets the target, on the JS thread
+    void halt();
+    void detach();
+
+    void main();
+    std::string runOnce(clock_t::time_point&);
+    void waitUntil(clock_t::time_point);
+    void flush(std::vector<pcpp::RawPacket>&, size_t, size_t, const std::vector<clock_t::time_point>&);
+    Napi::Object statsObject(Napi::Env);
+    ReplayStats snapshot();
+
+    ReplayConfig config;
+    sender_t send;
+    Napi::ObjectReference targetRef;
+    // the one the thread sends through, registered there while it runs
+    PcapDevice* device = nullptr;
+    Socket::Socket* socket = nullptr;
+
+    std::thread thread;
+    TSFN done;
+    promise_t deferred;
+    std::atomic<bool> running = false;
+    std::atomic<bool> stopping = false;
+    clock_t::time_point startedAt;
+    clock_t::time_point finishedAt;
+
+    std::atomic<uint64_t> packets = 0;
+    std::atomic<uint64_t> bytes = 0;
+    std::atomic<uint64_t> failed = 0;
+    std::atomic<uint64_t> loops = 0;
+    std::atomic<uint64_t> timingErrorSumNs = 0;
+    std::atomic<uint64_t> timingErrorMaxNs = 0;
+  };
+}
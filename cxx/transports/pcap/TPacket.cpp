@@ -0,0 +1,374 @@
+#include "TPacket.hpp"
+#include "Injector.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <poll.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <net/ethernet.h>
+#include <linux/filter.h>
+#include "error/Error.hpp"
+#endif
+
+namespace OverTheWire::Transports::Pcap {
+
+#ifdef __linux__
+
+TPacketRing::~TPacketRing() {
+  close();
+}
+
+std::string TPacketRing::open(const std::string& iface, const TPacketConfig& cfg) {
+  config = cfg;
+
+  ifindex = if_nametoindex(iface.c_str());
+  if (ifindex == 0) {
+    return "Could not find device";
+  }
+
+  fd = ::socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+  if (fd < 0) {
+    return getSystemError();
+  }
+
+  int version = TPACKET_V3;
+  if (::setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+    return getSystemError();
+  }
+
+  if (!config.out) {
+    int ignore = 1;
+    ::setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignore, sizeof(ignore));
+  }
+
+  tpacket_req3 req{};
+  req.tp_block_size = config.blockSize;
+  req.tp_block_nr = config.blockCount;
+  req.tp_frame_size = config.frameSize;
+  req.tp_frame_nr = (config.blockSize / config.frameSize) * config.blockCount;
+  req.tp_retire_blk_tov = config.retireTimeoutMs;
+  req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
+  if (::setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    return getSystemError();
+  }
+
+  mapSize = size_t{config.blockSize} * config.blockCount;
+  void* mem = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (mem == MAP_FAILED) {
+    mapSize = 0;
+    return getSystemError();
+  }
+  maps.push_back(Mapping{static_cast<uint8_t*>(mem), std::vector<bool>(config.blockCount)});
+  blocks.resize(config.blockCount);
+  for (size_t i{}; i < config.blockCount; ++i) {
+    blocks[i] = maps[0].base + i * config.blockSize;
+  }
+
+  handedOut.reset(new std::atomic<bool>[config.blockCount]);
+  for (size_t i{}; i < config.blockCount; ++i) {
+    handedOut[i] = false;
+  }
+
+  sockaddr_ll ll{};
+  ll.sll_family = AF_PACKET;
+  ll.sll_protocol = htons(ETH_P_ALL);
+  ll.sll_ifindex = ifindex;
+  if (::bind(fd, (sockaddr*)&ll, sizeof(ll)) < 0) {
+    return getSystemError();
+  }
+
+  if (config.fanoutMode >= 0) {
+    // every socket joining with the same id on this interface gets its share of the traffic
+    int flags = config.fanoutDefrag ? PACKET_FANOUT_FLAG_DEFRAG : 0;
+    int arg = config.fanoutId | ((config.fanoutMode | flags) << 16);
+    if (::setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0) {
+      return "PACKET_FANOUT: " + getSystemError();
+    }
+  }
+
+  if (config.promiscuous) {
+    packet_mreq mreq{};
+    mreq.mr_ifindex = ifindex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if (::setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+      return getSystemError();
+    }
+  }
+
+  return "";
+}
+
+std::string TPacketRing::attachFilter(const bpf_program& prog) {
+  sock_fprog fprog{};
+  fprog.len = prog.bf_len;
+  fprog.filter = reinterpret_cast<sock_filter*>(prog.bf_insns);
+  if (::setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+    return getSystemError();
+  }
+  return "";
+}
+
+TPacketStats TPacketRing::stats() {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  tpacket_stats_v3 st{};
+  socklen_t len = sizeof(st);
+  // the kernel resets the counters on every read
+  if (fd >= 0 && ::getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+    totals.packets += st.tp_packets;
+    totals.drops += st.tp_drops;
+    totals.freezes += st.tp_freeze_q_cnt;
+  }
+  totals.stalls = stalls.load(std::memory_order_relaxed);
+  return totals;
+}
+
+uint8_t* TPacketRing::block(size_t idx) {
+  std::lock_guard<std::mutex> lock{blocksMutex};
+  return blocks[idx];
+}
+
+void TPacketRing::releaseBlock(size_t idx) {
+  auto* desc = reinterpret_cast<tpacket_block_desc*>(blocks[idx]);
+  __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+  handedOut[idx].store(false, std::memory_order_release);
+}
+
+void TPacketRing::returnBlock(size_t idx, uint8_t* mem) {
+  std::lock_guard<std::mutex> lock{blocksMutex};
+  if (blocks[idx] == mem) {
+    releaseBlock(idx);
+    return;
+  }
+  // the ring got this block back in takeOver(), mem is the copy
+  ::munmap(mem, config.blockSize);
+}
+
+std::string TPacketRing::takeOver(size_t idx) {
+  std::lock_guard<std::mutex> lock{blocksMutex};
+  if (!handedOut[idx].load(std::memory_order_acquire)) {
+    // released in the meantime
+    return "";
+  }
+
+  // a mapping of the ring where this block wasn't replaced yet
+  Mapping* next = nullptr;
+  for (auto& m : maps) {
+    if (!m.replaced[idx] && m.base + idx * config.blockSize != blocks[idx]) {
+      next = &m;
+      break;
+    }
+  }
+  if (!next) {
+    void* mem = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+      return getSystemError();
+    }
+    maps.push_back(Mapping{static_cast<uint8_t*>(mem), std::vector<bool>(config.blockCount)});
+    next = &maps.back();
+  }
+
+  uint8_t* held = blocks[idx];
+  void* copy = ::mmap(nullptr, config.blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (copy == MAP_FAILED) {
+    return getSystemError();
+  }
+  std::memcpy(copy, held, config.blockSize);
+  // swaps the pages under JS in one go, the bytes stay the same
+  if (::mremap(copy, config.blockSize, config.blockSize, MREMAP_MAYMOVE | MREMAP_FIXED, held) == MAP_FAILED) {
+    auto err = getSystemError();
+    ::munmap(copy, config.blockSize);
+    return err;
+  }
+  for (auto& m : maps) {
+    if (held >= m.base && held < m.base + mapSize) {
+      m.replaced[idx] = true;
+    }
+  }
+
+  blocks[idx] = next->base + idx * config.blockSize;
+  stalls.fetch_add(1, std::memory_order_relaxed);
+  releaseBlock(idx);
+  return "";
+}
+
+void TPacketRing::close() {
+  // replaced blocks are unmapped by their batches, the holes may belong to someone else by now
+  for (auto& m : maps) {
+    for (size_t i{}; i < m.replaced.size(); ++i) {
+      if (!m.replaced[i]) {
+        ::munmap(m.base + i * config.blockSize, config.blockSize);
+      }
+    }
+  }
+  maps.clear();
+  blocks.clear();
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+BlockBatch::BlockBatch(tpacket_ring_ptr_t ring, size_t idx) : ring{ring}, idx{idx}, mem{ring->block(idx)} {}
+
+BlockBatch::~BlockBatch() {
+  ring->returnBlock(idx, mem);
+}
+
+uint8_t* BlockBatch::data() {
+  return mem;
+}
+
+size_t BlockBatch::bytes() const {
+  return ring->config.blockSize;
+}
+
+TPacketCapture::~TPacketCapture() {
+  stop();
+}
+
+std::string TPacketCapture::open(const std::string& iface, const TPacketConfig& config) {
+  ring = std::make_shared<TPacketRing>();
+  auto err = ring->open(iface, config);
+  if (err.size() > 0) {
+    ring.reset();
+  }
+  return err;
+}
+
+bool TPacketCapture::start(on_block_t blockCb, on_packet_t packetCb) {
+  if (!ring || running) {
+    return false;
+  }
+  onBlock = blockCb;
+  onPacket = packetCb;
+  running = true;
+  thread = std::thread{&TPacketCapture::captureMain, this};
+  return true;
+}
+
+void TPacketCapture::stop() {
+  running = false;
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+bool TPacketCapture::active() {
+  return running;
+}
+
+int TPacketCapture::send(const pcpp::RawPacket* packets, int n) {
+  return sendFrames(ring->fd, packets, n);
+}
+
+void TPacketCapture::captureMain() {
+  DEBUG_OUTPUT("TPacketCapture::captureMain");
+  // only this thread moves it, stop() joins before another one starts
+  size_t& cur = ring->cursor;
+  pollfd pfd{};
+  pfd.fd = ring->fd;
+  pfd.events = POLLIN | POLLERR;
+
+  while (running) {
+    if (ring->handedOut[cur].load(std::memory_order_acquire)) {
+      // JS still holds the block the kernel wants next, it keeps a copy and the ring gets the block back
+      if (ring->takeOver(cur).size() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+    }
+
+    auto* desc = reinterpret_cast<tpacket_block_desc*>(ring->block(cur));
+    if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+      ::poll(&pfd, 1, 100);
+      continue;
+    }
+
+    walkBlock(cur);
+    cur = (cur + 1) % ring->config.blockCount;
+  }
+}
+
+void TPacketCapture::walkBlock(size_t idx) {
+  uint8_t* start = ring->block(idx);
+  auto* desc = reinterpret_cast<tpacket_block_desc*>(start);
+  uint32_t n = desc->hdr.bh1.num_pkts;
+  auto* hdr = reinterpret_cast<tpacket3_hdr*>(start + desc->hdr.bh1.offset_to_first_pkt);
+
+  bool zeroCopy = static_cast<bool>(onBlock);
+  std::unique_ptr<BlockBatch> batch;
+  if (zeroCopy) {
+    ring->handedOut[idx].store(true, std::memory_order_release);
+    batch = std::make_unique<BlockBatch>(ring, idx);
+    batch->meta.reserve(n * PacketBatch::fields);
+  }
+
+  for (uint32_t i{}; i < n; ++i) {
+    auto* ll = reinterpret_cast<sockaddr_ll*>(reinterpret_cast<uint8_t*>(hdr) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+    bool outgoing = ll->sll_pkttype == PACKET_OUTGOING;
+
+    if ((outgoing && ring->config.out) || (!outgoing && ring->config.in)) {
+      uint8_t* frame = reinterpret_cast<uint8_t*>(hdr) + hdr->tp_mac;
+      if (zeroCopy) {
+        batch->meta.insert(batch->meta.end(), {
+          static_cast<uint32_t>(frame - start),
+          hdr->tp_snaplen,
+          hdr->tp_len,
+          hdr->tp_sec,
+          hdr->tp_nsec,
+        });
+      }
+      else {
+        timespec ts{ static_cast<time_t>(hdr->tp_sec), static_cast<long>(hdr->tp_nsec) };
+        onPacket(frame, hdr->tp_snaplen, hdr->tp_len, ts);
+      }
+    }
+
+    hdr = reinterpret_cast<tpacket3_hdr*>(reinterpret_cast<uint8_t*>(hdr) + hdr->tp_next_offset);
+  }
+
+  if (!zeroCopy) {
+    ring->releaseBlock(idx);
+  }
+  else if (batch->size() == 0) {
+    batch.reset();
+  }
+  else {
+    onBlock(batch.release());
+  }
+}
+
+#else
+
+static const char* unsupported = "TPACKET_V3 backend is only available on Linux";
+
+TPacketRing::~TPacketRing() {}
+std::string TPacketRing::open(const std::string&, const TPacketConfig&) { return unsupported; }
+std::string TPacketRing::attachFilter(const bpf_program&) { return unsupported; }
+TPacketStats TPacketRing::stats() { return totals; }
+uint8_t* TPacketRing::block(size_t) { return nullptr; }
+void TPacketRing::releaseBlock(size_t) {}
+void TPacketRing::returnBlock(size_t, uint8_t*) {}
+std::string TPacketRing::takeOver(size_t) { return unsupported; }
+void TPacketRing::close() {}
+
+BlockBatch::BlockBatch(tpacket_ring_ptr_t ring, size_t idx) : ring{ring}, idx{idx}, mem{nullptr} {}
+BlockBatch::~BlockBatch() {}
+uint8_t* BlockBatch::data() { return nullptr; }
+size_t BlockBatch::bytes() const { return 0; }
+
+TPacketCapture::~TPacketCapture() {}
+std::string TPacketCapture::open(const std::string&, const TPacketConfig&) { return unsupported; }
+bool TPacketCapture::start(on_block_t, on_packet_t) { return false; }
+void TPacketCapture::stop() {}
+bool TPacketCapture::active() { return false; }
+int TPacketCapture::send(const pcpp::RawPacket*, int) { return 0; }
+void TPacketCapture::captureMain() {}
+void TPacketCapture::walkBlock(size_t) {}
+
+#endif
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "common.hpp"
+#include "PacketBatch.hpp"
+#include "RawPacket.h"
+#include "pcap.h"
+
+#ifdef __linux__
+#include <linux/if_packet.h>
+#endif
+
+/* Linux-only capture backend: an AF_PACKET socket with a TPACKET_V3
+ * memory-mapped RX ring. A retired block is handed to JS as is, the
+ * meta table just points into it, and the block goes back to the kernel
+ * when the JS buffer over it is garbage collected. A packet kept by JS
+ * would pin its block, so when the capture thread gets back to a block
+ * that is still held, the block is copied out of the ring: the copy is
+ * remapped in its place, JS sees the same bytes at the same address, and
+ * the ring block is read through another mapping of the ring from then on
+ * and goes back to the kernel right away. Everything in here
+ * reports errors as strings, PcapDevice turns them into JS exceptions.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+
+  struct TPacketConfig {
+    uint32_t blockSize = 1 << 20;
+    uint32_t blockCount = 32;
+    uint32_t frameSize = 2048;
+    uint32_t retireTimeoutMs = 10;
+    bool promiscuous = true;
+    bool in = true;
+    bool out = true;
+    // PACKET_FANOUT_* or -1 to stay out of any fanout group
+    int fanoutMode = -1;
+    uint16_t fanoutId = 0;
+    bool fanoutDefrag = false;
+  };
+
+  struct TPacketStats {
+    uint64_t packets = 0;
+    uint64_t drops = 0;
+    uint64_t freezes = 0;
+    // times the next block was still held by JS and was copied out of the ring
+    uint64_t stalls = 0;
+  };
+
+  /* Owns the socket and the mapping. Shared with every block that is
+   * still referenced from JS, so the memory outlives the device if needed.
+   */
+  struct TPacketRing {
+    ~TPacketRing();
+
+    std::string open(const std::string&, const TPacketConfig&);
+    std::string attachFilter(const bpf_program&);
+    TPacketStats stats();
+    uint8_t* block(size_t);
+    void releaseBlock(size_t);
+    // by a batch that got the block at mem
+    void returnBlock(size_t, uint8_t* mem);
+    std::string takeOver(size_t);
+    void close();
+
+    struct Mapping {
+      uint8_t* base;
+      // blocks whose pages were replaced by a copy
+      std::vector<bool> replaced;
+    };
+
+    SOCKET fd = -1;
+    int ifindex = 0;
+    size_t mapSize = 0;
+    // the first one is made by open(), the others by takeOver()
+    std::vector<Mapping> maps;
+    // where every block of the ring is read now
+    std::vector<uint8_t*> blocks;
+    std::mutex blocksMutex;
+    TPacketConfig config;
+    std::unique_ptr<std::atomic<bool>[]> handedOut;
+    std::atomic<uint64_t> stalls = 0;
+    // the next block to read, the kernel goes on filling the ring between captures
+    size_t cursor = 0;
+    TPacketStats totals;
+    std::mutex statsMutex;
+  };
+
+  using tpacket_ring_ptr_t = std::shared_ptr<TPacketRing>;
+
+  struct BlockBatch : public PacketBatch {
+    BlockBatch(tpacket_ring_ptr_t, size_t);
+    ~BlockBatch() override;
+    uint8_t* data() override;
+    size_t bytes() const override;
+
+    tpacket_ring_ptr_t ring;
+    size_t idx;
+    uint8_t* mem;
+  };
+
+  struct TPacketCapture {
+    using on_block_t = std::function<void(PacketBatch*)>;
+    using on_packet_t = std::function<void(const uint8_t*, uint32_t, uint32_t, const timespec&)>;
+
+    ~TPacketCapture();
+
+    std::string open(const std::string&, const TPacketConfig&);
+    bool start(on_block_t, on_packet_t);
+    void stop();
+    bool active();
+    int send(const pcpp::RawPacket*, int);
+
+    void captureMain();
+    void walkBlock(size_t);
+
+    tpacket_ring_ptr_t ring;
+    on_block_t onBlock;
+    on_packet_t onPacket;
+    std::thread thread;
+    std::atomic<bool> running = false;
+  };
+}
@@ -0,0 +1,174 @@
+#include "Transmitter.hpp"
+
+namespace OverTheWire::Transports::Pcap {
+
+static size_t roundUpPow2(size_t v) {
+  size_t res = 1;
+  while (res < v) {
+    res <<= 1;
+  }
+  return res;
+}
+
+Transmitter::Transmitter(size_t capacity) : slots(roundUpPow2(std::max<size_t>(capacity, 2))) {
+  mask = slots.size() - 1;
+}
+
+Transmitter::~Transmitter() {
+  stop();
+  for (auto* job : done) {
+    delete job;
+  }
+}
+
+void Transmitter::setSchedule(schedule_t fn) {
+  std::lock_guard<std::mutex> lock{doneMutex};
+  schedule = fn;
+}
+
+void Transmitter::start(sender_t fn) {
+  send = fn;
+  stopping = false;
+  thread = std::thread{&Transmitter::main, this};
+}
+
+bool Transmitter::running() {
+  return thread.joinable();
+}
+
+bool Transmitter::offer(TxJob* job) {
+  size_t h = head.load(std::memory_order_relaxed);
+  if (h - tail.load(std::memory_order_acquire) >= slots.size()) {
+    return false;
+  }
+
+  job->queuedAt = std::chrono::steady_clock::now();
+  slots[h & mask] = job;
+  head.store(h + 1, std::memory_order_seq_cst);
+
+  // pairs with the store to `waiting` in main(), one of the two sides sees the other
+  if (waiting.load(std::memory_order_seq_cst)) {
+    std::lock_guard<std::mutex> lock{wakeMutex};
+    wake.notify_one();
+  }
+  return true;
+}
+
+TxJob* Transmitter::pop() {
+  size_t t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  auto* job = slots[t & mask];
+  tail.store(t + 1, std::memory_order_release);
+  return job;
+}
+
+void Transmitter::main() {
+  DEBUG_OUTPUT("Transmitter::main");
+  while (true) {
+    auto* job = pop();
+    if (job) {
+      job->accepted = send(job->packets.data(), job->packets.size());
+      complete(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{wakeMutex};
+    waiting.store(true, std::memory_order_seq_cst);
+    wake.wait(lock, [this]() {
+      return stopping.load() || head.load(std::memory_order_seq_cst) != tail.load(std::memory_order_relaxed);
+    });
+    waiting.store(false, std::memory_order_relaxed);
+
+    // whatever was written before stop() is still sent
+    if (stopping.load() && head.load() == tail.load(std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void Transmitter::complete(TxJob* job) {
+  uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - job->queuedAt
+  ).count();
+
+  packets.fetch_add(job->accepted, std::memory_order_relaxed);
+  if (static_cast<size_t>(job->accepted) != job->packets.size()) {
+    errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  jobs.fetch_add(1, std::memory_order_relaxed);
+  latencySumUs.fetch_add(latency, std::memory_order_relaxed);
+  // only this thread writes it
+  if (latency > latencyMaxUs.load(std::memory_order_relaxed)) {
+    latencyMaxUs.store(latency, std::memory_order_relaxed);
+  }
+
+  schedule_t fn;
+  {
+    std::lock_guard<std::mutex> lock{doneMutex};
+    // one call is enough for everything that finishes before JS gets to it
+    if (done.empty()) {
+      fn = schedule;
+    }
+    done.push_back(job);
+  }
+  if (fn) {
+    fn();
+  }
+}
+
+void Transmitter::stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{wakeMutex};
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+std::vector<TxJob*> Transmitter::takeDone() {
+  std::vector<TxJob*> res;
+  std::lock_guard<std::mutex> lock{doneMutex};
+  res.swap(done);
+  return res;
+}
+
+TxStats Transmitter::stats() {
+  uint64_t n = jobs.load(std::memory_order_relaxed);
+  return {
+    head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed),
+    packets.load(std::memory_order_relaxed),
+    errors.load(std::memory_order_relaxed),
+    n > 0 ? latencySumUs.load(std::memory_order_relaxed) / n : 0,
+    latencyMaxUs.load(std::memory_order_relaxed),
+  };
+}
+
+void CallJsTx(Napi::Env env, Napi::Function, Transmitter* tx, TxJob*) {
+  DEBUG_OUTPUT("CallJsTx");
+  for (auto* job : tx->takeDone()) {
+    std::unique_ptr<TxJob> guard{job};
+    if (env == nullptr) {
+      continue;
+    }
+    job->pins.clear();
+    size_t total = job->packets.size();
+    if (job->reportAccepted) {
+      job->callback.Call({ env.Null(), Napi::Number::New(env, job->accepted) });
+    }
+    else if (static_cast<size_t>(job->accepted) == total) {
+      job->callback.Call({});
+    }
+    else {
+      auto err = Napi::Error::New(env, "Error sending packet, " + std::to_string(job->accepted) + " of " + std::to_string(total) + " sent");
+      err.Set("accepted", Napi::Number::New(env, job->accepted));
+      job->callback.Call({ err.Value() });
+    }
+  }
+}
+
+}
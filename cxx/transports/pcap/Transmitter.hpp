@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "RawPacket.h"
+
+/* Every device sends from its own thread. Writes get there through a
+ * single-producer/single-consumer ring (the JS thread is the only
+ * producer), so they leave in the order they were written and never
+ * compete with fs or dns for the libuv threadpool. Finished writes are
+ * collected and their callbacks are all called from one TSFN call.
+ */
+
+namespace OverTheWire::Transports::Pcap {
+  using packets_t = std::vector<pcpp::RawPacket>;
+  using pins_t = std::vector<Napi::ObjectReference>;
+  using sender_t = std::function<int(const pcpp::RawPacket*, int)>;
+
+  /* The packets point straight into the JS buffers, pins keep those
+   * alive until the callback is called. Only the JS thread touches
+   * pins and callback.
+   */
+  struct TxJob {
+    packets_t packets;
+    pins_t pins;
+    Napi::FunctionReference callback;
+    std::chrono::steady_clock::time_point queuedAt;
+    int accepted = 0;
+    // callback(null, accepted) instead of an error on partial sends
+    bool reportAccepted = false;
+  };
+
+  struct TxStats {
+    size_t depth = 0;
+    uint64_t packets = 0;
+    uint64_t errors = 0;
+    uint64_t latencyAvgUs = 0;
+    uint64_t latencyMaxUs = 0;
+  };
+
+  struct Transmitter {
+    using schedule_t = std::function<void()>;
+
+    Transmitter(size_t);
+    ~Transmitter();
+
+    void setSchedule(schedule_t);
+    void start(sender_t);
+    bool running();
+    bool offer(TxJob*);
+    void stop();
+    std::vector<TxJob*> takeDone();
+    TxStats stats();
+
+    void main();
+    TxJob* pop();
+    void complete(TxJob*);
+
+    std::vector<TxJob*> slots;
+    size_t mask;
+    // free-running counters, head is written by the JS thread, tail by the TX thread
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+
+    sender_t send;
+    std::thread thread;
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> waiting = false;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    std::mutex doneMutex;
+    std::vector<TxJob*> done;
+    schedule_t schedule;
+
+    std::atomic<uint64_t> packets = 0;
+    std::atomic<uint64_t> errors = 0;
+    std::atomic<uint64_t> jobs = 0;
+    std::atomic<uint64_t> latencySumUs = 0;
+    std::atomic<uint64_t> latencyMaxUs = 0;
+  };
+
+  void CallJsTx(Napi::Env, Napi::Function, Transmitter*, TxJob*);
+  using TxTSFN = Napi::TypedThreadSafeFunction<Transmitter, TxJob, CallJsTx>;
+}
@@ -74,6 +74,7 @@ Napi::Object InitSystemLocal(Napi::Env env, Napi::Object exports) {
   ENUM_VALUE(PF_XDP);
 
 //setsockopt levels
+  ENUM_VALUE(SOL_SOCKET);
   ENUM_VALUE(SOL_IP);
   ENUM_VALUE(SOL_IPV6);
   ENUM_VALUE(SOL_ICMPV6);
@@ -102,6 +103,33 @@ Napi::Object InitSystemLocal(Napi::Env env, Napi::Object exports) {
   ENUM_VALUE(SOL_TLS);
   ENUM_VALUE(SOL_XDP);
 
+  ENUM_VALUE(SO_DEBUG);
+  ENUM_VALUE(SO_REUSEADDR);
+  ENUM_VALUE(SO_REUSEPORT);
+  ENUM_VALUE(SO_KEEPALIVE);
+  ENUM_VALUE(SO_DONTROUTE);
+  ENUM_VALUE(SO_LINGER);
+  ENUM_VALUE(SO_BROADCAST);
+  ENUM_VALUE(SO_OOBINLINE);
+  ENUM_VALUE(SO_SNDBUF);
+  ENUM_VALUE(SO_RCVBUF);
+  ENUM_VALUE(SO_SNDLOWAT);
+  ENUM_VALUE(SO_RCVLOWAT);
+  ENUM_VALUE(SO_SNDTIMEO);
+  ENUM_VALUE(SO_RCVTIMEO);
+  ENUM_VALUE(SO_TYPE);
+  ENUM_VALUE(SO_ERROR);
+#ifdef __linux__
+  ENUM_VALUE(SO_ATTACH_FILTER);   // the value is a Buffer of sock_filter instructions
+  ENUM_VALUE(SO_DETACH_FILTER);
+  ENUM_VALUE(SO_LOCK_FILTER);
+  ENUM_VALUE(SO_ATTACH_REUSEPORT_CBPF);
+  ENUM_VALUE(SO_INCOMING_CPU);
+#endif
+#ifdef SO_DETACH_REUSEPORT_BPF
+  ENUM_VALUE(SO_DETACH_REUSEPORT_BPF);
+#endif
+
   ENUM_VALUE(IPPROTO_IP);
   ENUM_VALUE(IPPROTO_HOPOPTS);
   ENUM_VALUE(IPPROTO_ICMP);
@@ -23,6 +23,7 @@ Napi::Object InitSystemLocal(Napi::Env env, Napi::Object exports) {
   ENUM_VALUE(PF_DECnet);
   ENUM_VALUE(PF_KEY);
 
+  ENUM_VALUE(SOL_SOCKET);
   ENUM_VALUE(SO_DEBUG);
   ENUM_VALUE(SO_REUSEADDR);
   ENUM_VALUE(SO_REUSEPORT);
@@ -1,13 +1,16 @@
 #include "InputPackets.hpp"
 
+#ifdef __linux__
+#include <netinet/udp.h>
+#endif
+
 namespace OverTheWire::Transports::Socket {
 
-read_res_t&& emptyRes() {
-  auto res = std::make_pair<cxx_buffer_t, addr_t>(
-    std::make_pair<std::unique_ptr<uint8_t>, size_t>(nullptr, 0),
+read_res_t emptyRes() {
+  return std::make_pair<RecvSlice, addr_t>(
+    RecvSlice{},
     std::make_pair<std::unique_ptr<sockaddr>, size_t>(nullptr, 0)
   );
-  return std::move(res);
 }
 
 InputPacketsIterator::InputPacketsIterator(InputPacketReader& parent, size_t idx, bool isNull) 
@@ -16,18 +19,112 @@ InputPacketsIterator::InputPacketsIterator(InputPacketReader& parent, size_t idx
 InputPacketsIterator::InputPacketsIterator(const InputPacketsIterator& other) 
   : parent{other.parent}, idx{other.idx}, isNull{other.isNull}, value{std::make_pair(std::string{""}, emptyRes())} {}
 
+void RecvBatch::prepare(size_t n, size_t size) {
+  if (size != bufSize) {
+    bufs.clear();
+    bufSize = size;
+  }
+  bufs.resize(n);
+#ifdef __linux__
+  msgs.resize(n);
+  iovecs.resize(n);
+  addrs.resize(n);
+  controls.resize(n);
+#endif
+  for (size_t i{}; i < n; ++i) {
+    if (!bufs[i]) {
+      bufs[i] = decltype(bufs)::value_type{new uint8_t[bufSize]};
+    }
+  }
+}
+
+#ifdef __linux__
+size_t RecvBatch::receive(SOCKET fd, bool queryAddr, std::string& err) {
+  size_t n = bufs.size();
+  for (size_t i{}; i < n; ++i) {
+    iovecs[i].iov_base = bufs[i].get();
+    iovecs[i].iov_len = bufSize;
+    msgs[i] = mmsghdr{};
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (queryAddr) {
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    }
+    if (gro) {
+      msgs[i].msg_hdr.msg_control = controls[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+    }
+  }
+
+  int nread;
+  do {
+    nread = recvmmsg(fd, msgs.data(), n, 0, nullptr);
+  } while (nread == -1 && errno == EINTR);
+
+  if (nread == -1) {
+    // the socket is drained, not an error
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      err = getSystemError();
+    }
+    return 0;
+  }
+  return nread;
+}
+
+read_res_t RecvBatch::take(size_t i, bool queryAddr, bool copy, RecvPool& pool) {
+  auto res = emptyRes();
+  if (copy) {
+    res.pBuf = pool.copy(bufs[i].get(), msgs[i].msg_len);
+  }
+  else {
+    res.pBuf = RecvSlice{bufs[i].get(), msgs[i].msg_len, nullptr};
+  }
+#ifdef UDP_GRO
+  if (gro) {
+    auto* hdr = &msgs[i].msg_hdr;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(hdr); cm; cm = CMSG_NXTHDR(hdr, cm)) {
+      if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+        int segment;
+        memcpy(&segment, CMSG_DATA(cm), sizeof(segment));
+        res.pBuf.segment = segment;
+      }
+    }
+  }
+#endif
+  if (queryAddr) {
+    std::unique_ptr<struct sockaddr> peer = decltype(peer){(sockaddr*)new struct sockaddr_storage};
+    memcpy(peer.get(), &addrs[i], sizeof(sockaddr_storage));
+    res.pAddr = std::make_pair(std::move(peer), sizeof(sockaddr_storage));
+  }
+  return res;
+}
+#else
+size_t RecvBatch::receive(SOCKET, bool, std::string&) { return 0; }
+read_res_t RecvBatch::take(size_t, bool, bool, RecvPool&) { return emptyRes(); }
+#endif
+
 void InputPacketsIterator::read() {
   if (was) return;
   was = true;
 
-#ifdef _WIN32
+#ifdef __linux__
+  if (idx < parent.received) {
+    value.pData = parent.batch.take(idx, parent.queryAddr, parent.copy, parent.pool);
+  }
+  else {
+    value.pErr = parent.batchErr;
+    isNull = true;
+  }
+#elif defined(_WIN32)
   //TODO
   WSAOVERLAPPED ioOverlapped = { 0 };
   DWORD bytes = 0;
   DWORD flags = 0;
   int result;
   WSABUF buf;
-  buf.buf = (char*)new uint8_t[parent.bufSize];
+  size_t slot = parent.scratchSlot(idx);
+  buf.buf = (char*)parent.batch.bufs[slot].get();
   buf.len = parent.bufSize;
 
   if (parent.queryAddr) {
@@ -58,25 +155,25 @@ void InputPacketsIterator::read() {
   if (result == -1) {
     value.pErr = getSystemError();
     isNull = true;
-    delete buf.buf;
   }
-  value.pData.pBuf = std::make_pair(decltype(value.second.first.first){(uint8_t*)buf.buf}, result);
-//TODO recvmmsg is way too hard to implenet here, so I save it for later
+  else {
+    value.pData.pBuf = parent.slice((uint8_t*)buf.buf, bytes);
+  }
 #else
   msghdr h{};
   ssize_t nread = 0;
   std::unique_ptr<struct sockaddr> peer = decltype(peer){(sockaddr*)new struct sockaddr_storage};
-  std::unique_ptr<uint8_t> buf = decltype(buf){new uint8_t[parent.bufSize]};
-  std::unique_ptr<struct iovec> iovec = decltype(iovec){new struct iovec};
+  iovec iov;
 
-  iovec->iov_base = (void*)buf.get();
-  iovec->iov_len = parent.bufSize;
+  size_t slot = parent.scratchSlot(idx);
+  iov.iov_base = (void*)parent.batch.bufs[slot].get();
+  iov.iov_len = parent.bufSize;
 
   memset(&h, 0, sizeof(h));
   memset(peer.get(), 0, sizeof(*peer.get()));
   h.msg_name = peer.get();
   h.msg_namelen = sizeof(sockaddr_storage);
-  h.msg_iov = iovec.get();
+  h.msg_iov = &iov;
   h.msg_iovlen = 1;
 
   do {
@@ -88,7 +185,7 @@ void InputPacketsIterator::read() {
     isNull = true;
   }
   else {
-    value.pData.pBuf = std::make_pair(std::move(buf), nread);
+    value.pData.pBuf = parent.slice(parent.batch.bufs[slot].get(), nread);
     if (parent.queryAddr) {
       value.pData.pAddr = std::make_pair(std::move(peer), sizeof(sockaddr_storage));
     }
@@ -98,7 +195,7 @@ void InputPacketsIterator::read() {
 
 void InputPacketsIterator::incr() {
   if (isNull) return;
-  if (++idx == parent.maxRead) {
+  if (++idx >= parent.limit()) {
     isNull = true;
     idx = -1;
   }
@@ -138,10 +235,40 @@ bool operator!=(const InputPacketsIterator& a, const InputPacketsIterator& b) {
 };
 
 
-InputPacketReader::InputPacketReader(SOCKET fd, size_t bufSize = defaultBufferSize, bool queryAddr = true) : fd{fd}, queryAddr{queryAddr}, bufSize{bufSize} {}
+InputPacketReader::InputPacketReader(SOCKET fd, size_t bufSize, bool queryAddr, size_t maxRead, RecvBatch& batch, RecvPool& pool, bool copy) 
+  : fd{fd}, maxRead{std::max<size_t>(maxRead, 1)}, bufSize{bufSize}, queryAddr{queryAddr}, batch{batch}, pool{pool}, copy{copy} {}
+
+size_t InputPacketReader::scratchSlot(size_t idx) {
+  // uncopied datagrams have to stay around until the whole batch is read
+  size_t slot = copy ? 0 : idx;
+  batch.prepare(std::max(slot + 1, batch.bufs.size()), bufSize);
+  return slot;
+}
+
+RecvSlice InputPacketReader::slice(uint8_t* data, size_t len) {
+  if (copy) {
+    return pool.copy(data, len);
+  }
+  return RecvSlice{data, len, nullptr};
+}
+
+size_t InputPacketReader::limit() {
+#ifdef __linux__
+  // an error is reported as one more element
+  return batchErr.size() > 0 ? received + 1 : received;
+#else
+  return maxRead;
+#endif
+}
 
 InputPacketsIterator InputPacketReader::begin() {
+#ifdef __linux__
+  batch.prepare(maxRead, bufSize);
+  received = batch.receive(fd, queryAddr, batchErr);
+  return InputPacketsIterator(*this, 0, limit() == 0);
+#else
   return InputPacketsIterator(*this, 0, false);
+#endif
 }
 
 InputPacketsIterator InputPacketReader::end() {
@@ -6,6 +6,7 @@
 #include "Sys.hpp"
 #include "error/Error.hpp"
 #include "SockAddr.hpp"
+#include "RecvPool.hpp"
 
 /*
  * This is the class that tries to abstract away
@@ -20,11 +21,12 @@ namespace OverTheWire::Transports::Socket {
 #define pAddr second
 
   const size_t defaultBufferSize = 65'535;
+  const size_t defaultReadBatchSize = 32;
 
   struct InputPacketReader;
 
-  using read_res_t = std::pair<cxx_buffer_t, addr_t>;
-  read_res_t&& emptyRes();
+  using read_res_t = std::pair<RecvSlice, addr_t>;
+  read_res_t emptyRes();
 
   struct InputPacketsIterator {
     using iterator_category = std::input_iterator_tag;
@@ -55,15 +57,52 @@ namespace OverTheWire::Transports::Socket {
     bool isNull;
   };
 
+  /* Arrays for a single recvmmsg call, they live as long as the socket.
+   * The buffers are only scratch space, every datagram is copied into
+   * the pool with its exact size. Without copying the slices point into
+   * the scratch buffers and stay valid until the next read.
+   */
+  struct RecvBatch {
+    void prepare(size_t, size_t);
+    size_t receive(SOCKET, bool, std::string&);
+    read_res_t take(size_t, bool, bool, RecvPool&);
+
+    std::vector<std::unique_ptr<uint8_t>> bufs;
+#ifdef __linux__
+    struct GroControl {
+      alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(int))];
+    };
+
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iovecs;
+    std::vector<sockaddr_storage> addrs;
+    std::vector<GroControl> controls;
+#endif
+    size_t bufSize = 0;
+    // ask for the UDP_GRO segment size of every datagram
+    bool gro = false;
+  };
+
+  /* On Linux the whole batch is read with one recvmmsg in begin(),
+   * elsewhere every packet is a recvmsg of its own.
+   */
   struct InputPacketReader {
-    InputPacketReader(SOCKET, size_t, bool);
+    InputPacketReader(SOCKET, size_t, bool, size_t, RecvBatch&, RecvPool&, bool = true);
     InputPacketsIterator begin();
     InputPacketsIterator end();
+    size_t limit();
+    size_t scratchSlot(size_t);
+    RecvSlice slice(uint8_t*, size_t);
 
     SOCKET fd;
-    size_t maxRead = 32;
+    size_t maxRead = defaultReadBatchSize;
     size_t bufSize;
     bool queryAddr = true;
+    RecvBatch& batch;
+    RecvPool& pool;
+    bool copy = true;
+    size_t received = 0;
+    std::string batchErr;
   };
 
 }
@@ -1,18 +1,25 @@
 #include "Packets.hpp"
 
+#include <cstring>
+
+#ifdef __linux__
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#endif
+
 namespace OverTheWire::Transports::Socket {
 
 Packets::Packets(int& flags, bool& connected) : flags{flags}, connected{connected} {}
 
 #ifndef _WIN32
-std::pair<bool, msghdr> createMsghdr(uint8_t* buf, size_t size, sockaddr* addr, size_t addrSize, iovec* msgIov, bool connected) {
+std::pair<bool, msghdr> createMsghdr(uint8_t* buf, size_t size, const sockaddr* addr, size_t addrSize, iovec* msgIov, bool connected) {
   auto res = std::make_pair(true, msghdr{});
-  if (addr->sa_family == AF_UNSPEC || connected) {
+  if (connected || !addr || addr->sa_family == AF_UNSPEC) {
     res.second.msg_name = NULL;
     res.second.msg_namelen = 0;
   } 
   else {
-    res.second.msg_name = addr;
+    res.second.msg_name = (void*)addr;
     res.second.msg_namelen = addrSize;
   }
   msgIov->iov_base = buf;
@@ -24,17 +31,15 @@ std::pair<bool, msghdr> createMsghdr(uint8_t* buf, size_t size, sockaddr* addr,
 }
 #endif
 
-bool Packets::add(uint8_t* buf, size_t size, SockAddr* target) {
-  addr_t addr;
-  sockaddr* addrRaw = nullptr;
+bool Packets::add(uint8_t* buf, size_t size, SockAddr* target, const Napi::Value& pin, uint16_t segment) {
+  resolved_addr_t addr;
   if (!connected || addrs.size() == 0) {
     std::string err;
-    std::tie(err, addr) = target->addr();
+    std::tie(err, addr) = target->resolved();
     if (err.size() > 0 && !connected) {
       return false;
     }
-    addrRaw = addr.first.get();
-    addrs.push_back(std::move(addr));
+    addrs.push_back(addr);
   }
 #ifdef _WIN32
   WSABUF pkt;
@@ -46,8 +51,21 @@ bool Packets::add(uint8_t* buf, size_t size, SockAddr* target) {
   iovec* iovec = &iovecs.back();
   bool ok;
   msghdr msg;
-  std::tie(ok, msg) = createMsghdr(buf, size, addrRaw, addr.second, iovec, connected);
+  std::tie(ok, msg) = createMsghdr(buf, size, addr ? addr->get() : nullptr, addr ? addr->size : 0, iovec, connected);
   if (!ok) return false;
+#if defined(__linux__) && defined(UDP_SEGMENT)
+  if (segment > 0) {
+    // the kernel (or the NIC) cuts the buffer into datagrams of this size
+    controls.emplace_back();
+    msg.msg_control = controls.back().buf;
+    msg.msg_controllen = sizeof(controls.back().buf);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+  }
+#endif
 #if defined(__linux__) || defined(__FreeBSD__)
   mmsghdr p;
   p.msg_hdr = std::move(msg);
@@ -56,6 +74,8 @@ bool Packets::add(uint8_t* buf, size_t size, SockAddr* target) {
   packets.emplace_back(std::move(msg));
 #endif
 #endif
+  pins.push_back(Napi::Persistent(pin.As<Napi::Object>()));
+  bytes += size;
   return true;
 }
 
@@ -87,14 +107,16 @@ SendStatus Packets::send(SOCKET fd) {
                        1,
                        &bytes,
                        0,
-                       addr.first.get(),
-                       addr.second,
+                       addr->get(),
+                       addr->size,
                        &ioOverlapped,
                        NULL);
     }
 
     if (result == 0) {
+      this->bytes -= pkt->len;
       packets.pop_front();
+      pins.pop_front();
       if (!connected) {
         addrs.pop_front();
       }
@@ -111,8 +133,14 @@ SendStatus Packets::send(SOCKET fd) {
 
 #elif defined(__linux__) || defined(__FreeBSD__)
   int npkts;
+  int sendFlags = flags;
+#ifdef MSG_ZEROCOPY
+  if (zeroCopy) {
+    sendFlags |= MSG_ZEROCOPY;
+  }
+#endif
   do {
-    npkts = sendmmsg(fd, packets.data(), packets.size(), flags);
+    npkts = sendmmsg(fd, packets.data(), packets.size(), sendFlags);
   } while (npkts == -1 && errno == EINTR);
 
   if (npkts < 1) {
@@ -121,9 +149,37 @@ SendStatus Packets::send(SOCKET fd) {
     }
     return SendStatus::fail;
   }
+  if (zeroCopy) {
+    // every non-empty message got the next id of the socket
+    for (int i{}; i < npkts; ++i) {
+      if (packets[i].msg_hdr.msg_iov->iov_len == 0) {
+        continue;
+      }
+      inflight.push_back(ZeroCopyInFlight{zeroCopyNext++, std::move(pins[i])});
+      zeroCopyStats.sent++;
+    }
+  }
+
+  // only what the kernel took leaves the queue, the rest goes on the next call
+  for (int i{}; i < npkts; ++i) {
+    auto& hdr = packets[i].msg_hdr;
+    bytes -= hdr.msg_iov->iov_len;
+    if (hdr.msg_controllen > 0) {
+      controls.pop_front();
+    }
+    iovecs.pop_front();
+    pins.pop_front();
+    if (!connected) {
+      addrs.pop_front();
+    }
+  }
+  // the headers point into the deques, which didn't move
+  packets.erase(packets.begin(), packets.begin() + npkts);
+
+  if (packets.size() > 0) {
+    return SendStatus::again;
+  }
   addrs.clear();
-  packets.clear();
-  iovecs.clear();
   return SendStatus::ok;
 #else
   assert(packets.size() == iovecs.size());
@@ -147,14 +203,120 @@ SendStatus Packets::send(SOCKET fd) {
       return SendStatus::fail;
     }
 
+    bytes -= pkt.msg_iov->iov_len;
     packets.pop_front();
     iovecs.pop_front();
     addrs.pop_front();
+    pins.pop_front();
   }
   return SendStatus::ok;
 #endif
 }
 
+std::string Packets::setZeroCopy(SOCKET fd, bool on) {
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+  int val = on;
+  if (::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) < 0) {
+    return getSystemError();
+  }
+  zeroCopy = on;
+  return "";
+#else
+  return "Zero-copy sends are not supported on this platform";
+#endif
+}
+
+void Packets::complete(uint32_t lo, uint32_t hi) {
+  // completions may come out of order, the buffers are released in order
+  for (uint32_t id = lo; !inflight.empty(); ++id) {
+    size_t idx = id - inflight.front().id;
+    if (idx < inflight.size()) {
+      inflight[idx].done = true;
+    }
+    if (id == hi) {
+      break;
+    }
+  }
+  while (!inflight.empty() && inflight.front().done) {
+    inflight.pop_front();
+  }
+}
+
+std::pair<size_t, size_t> Packets::reap(SOCKET fd, std::string& err) {
+  size_t completed = 0;
+  size_t copied = 0;
+#if defined(__linux__) && defined(SO_EE_ORIGIN_ZEROCOPY)
+  while (true) {
+    char control[128];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int result;
+    do {
+      result = recvmsg(fd, &msg, MSG_ERRQUEUE);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        err = getSystemError();
+      }
+      break;
+    }
+
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      bool recvErr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+        (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+      if (!recvErr) {
+        continue;
+      }
+
+      auto* serr = (sock_extended_err*)CMSG_DATA(cm);
+      if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        if (serr->ee_errno != 0) {
+          err = std::strerror(serr->ee_errno);
+        }
+        continue;
+      }
+
+      // [ee_info, ee_data] is an inclusive range of ids
+      uint32_t lo = serr->ee_info;
+      uint32_t hi = serr->ee_data;
+      size_t n = uint32_t(hi - lo) + 1;
+      completed += n;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        copied += n;
+      }
+      complete(lo, hi);
+    }
+  }
+  zeroCopyStats.completed += completed;
+  zeroCopyStats.copied += copied;
+#endif
+  return std::make_pair(completed, copied);
+}
+
+#ifdef __linux__
+std::unique_ptr<Packets> Packets::detach() {
+  // moving the containers keeps every element where it is,
+  // so the headers still point to the right iovecs and addresses
+  auto res = std::make_unique<Packets>(flags, connected);
+  res->pins = std::move(pins);
+  res->addrs = std::move(addrs);
+  res->iovecs = std::move(iovecs);
+  res->controls = std::move(controls);
+  res->packets = std::move(packets);
+  res->bytes = bytes;
+  bytes = 0;
+  pins.clear();
+  addrs.clear();
+  iovecs.clear();
+  controls.clear();
+  packets.clear();
+  return res;
+}
+#endif
+
 size_t Packets::size() {
   return packets.size();
 }
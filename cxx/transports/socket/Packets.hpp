@@ -21,23 +21,60 @@ namespace OverTheWire::Transports::Socket {
 
   enum class SendStatus { again, ok, fail };
 
+  struct ZeroCopyStats {
+    uint64_t sent = 0;
+    uint64_t completed = 0;
+    // the kernel couldn't avoid the copy for these
+    uint64_t copied = 0;
+  };
+
+  /* A packet sent with MSG_ZEROCOPY, its buffer has to stay alive until
+   * the kernel reports the completion of its id on the error queue.
+   */
+  struct ZeroCopyInFlight {
+    uint32_t id;
+    Napi::ObjectReference pin;
+    bool done = false;
+  };
+
   struct Packets {
     Packets(int& flags, bool& connected);
-    bool add(uint8_t*, size_t, SockAddr*);
+    bool add(uint8_t*, size_t, SockAddr*, const Napi::Value&, uint16_t = 0);
     size_t size();
     SendStatus send(SOCKET);
+    std::string setZeroCopy(SOCKET, bool);
+    std::pair<size_t, size_t> reap(SOCKET, std::string&);
+    void complete(uint32_t, uint32_t);
+#ifdef __linux__
+    std::unique_ptr<Packets> detach();
+#endif
 
     int& flags;
     bool& connected;
+    // payload bytes still waiting to be sent
+    size_t bytes = 0;
+    // the packets point into these JS buffers until they are sent
+    std::deque<Napi::ObjectReference> pins;
+    bool zeroCopy = false;
+    uint32_t zeroCopyNext = 0;
+    std::deque<ZeroCopyInFlight> inflight;
+    ZeroCopyStats zeroCopyStats;
+    // the destinations are shared with the SockAddr objects, not copied
 #ifdef _WIN32
-    std::deque<addr_t> addrs;
+    std::deque<resolved_addr_t> addrs;
     std::deque<WSABUF> packets;
 #elif defined(__linux__) || defined(__FreeBSD__)
-    std::vector<addr_t> addrs;
-    std::vector<iovec> iovecs;
+    std::deque<resolved_addr_t> addrs;
+    struct SegmentControl {
+      alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(uint16_t))];
+    };
+
+    // the headers point into these, a deque doesn't move what's already there
+    std::deque<iovec> iovecs;
+    std::deque<SegmentControl> controls;
     std::vector<mmsghdr> packets;
 #else
-    std::deque<addr_t> addrs;
+    std::deque<resolved_addr_t> addrs;
     std::deque<iovec> iovecs;
     std::deque<msghdr> packets;
 #endif
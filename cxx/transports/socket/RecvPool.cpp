@@ -0,0 +1,131 @@
+#include "RecvPool.hpp"
+
+#include <cstring>
+
+namespace OverTheWire::Transports::Socket {
+
+static const size_t sliceHeader = sizeof(uint64_t);
+
+static size_t align8(size_t v) {
+  return (v + 7) & ~size_t{7};
+}
+
+RecvPoolState::~RecvPoolState() {
+  for (auto* chunk : free) {
+    delete chunk;
+  }
+}
+
+RecvPool::RecvPool(size_t chunkSize) : state{std::make_shared<RecvPoolState>()} {
+  state->chunkSize = chunkSize;
+}
+
+RecvPool::~RecvPool() {
+  state->alive = false;
+  for (auto* chunk : state->free) {
+    state->stats.chunks--;
+    state->stats.freeChunks--;
+    state->stats.bytesReserved -= chunk->size;
+    delete chunk;
+  }
+  state->free.clear();
+  if (current) {
+    unref(current);
+    current = nullptr;
+  }
+}
+
+void RecvPool::setChunkSize(size_t size) {
+  // chunks of the old size are dropped as they come back
+  state->chunkSize = size;
+}
+
+RecvChunk* RecvPool::newChunk(size_t size) {
+  auto* chunk = new RecvChunk;
+  chunk->mem = std::unique_ptr<uint8_t[]>{new uint8_t[size]};
+  chunk->size = size;
+  chunk->state = state;
+  state->stats.chunks++;
+  state->stats.bytesReserved += size;
+  return chunk;
+}
+
+RecvSlice RecvPool::alloc(size_t len) {
+  size_t need = sliceHeader + align8(len);
+  RecvChunk* chunk;
+
+  if (need > state->chunkSize) {
+    // too big to share a chunk, it gets one of its own
+    chunk = newChunk(need);
+  }
+  else {
+    if (!current || current->used + need > current->size) {
+      if (current) {
+        unref(current);
+      }
+      if (state->free.size() > 0) {
+        current = state->free.back();
+        current->state = state;
+        state->free.pop_back();
+        state->stats.freeChunks--;
+      }
+      else {
+        current = newChunk(state->chunkSize);
+      }
+      current->used = 0;
+      current->refs = 1;
+    }
+    chunk = current;
+  }
+
+  uint8_t* slot = chunk->mem.get() + chunk->used;
+  chunk->used += need;
+  chunk->refs++;
+
+  uint64_t header = len;
+  std::memcpy(slot, &header, sliceHeader);
+
+  state->stats.buffers++;
+  state->stats.bytesInUse += len;
+  return { slot + sliceHeader, len, chunk };
+}
+
+RecvSlice RecvPool::copy(const uint8_t* src, size_t len) {
+  auto slice = alloc(len);
+  std::memcpy(slice.data, src, len);
+  return slice;
+}
+
+void RecvPool::release(uint8_t* data, RecvChunk* chunk) {
+  uint64_t len;
+  std::memcpy(&len, data - sliceHeader, sliceHeader);
+  chunk->state->stats.buffers--;
+  chunk->state->stats.bytesInUse -= len;
+  unref(chunk);
+}
+
+void RecvPool::unref(RecvChunk* chunk) {
+  if (--chunk->refs > 0) {
+    return;
+  }
+
+  auto state = chunk->state;
+  if (state->alive && chunk->size == state->chunkSize && state->free.size() < maxFreeChunks) {
+    chunk->used = 0;
+    // a pooled chunk must not keep the state alive, that would be a cycle
+    chunk->state.reset();
+    state->free.push_back(chunk);
+    state->stats.freeChunks++;
+    return;
+  }
+
+  state->stats.chunks--;
+  state->stats.bytesReserved -= chunk->size;
+  delete chunk;
+}
+
+RecvPoolStats RecvPool::stats() {
+  return state->stats;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+
+#include "common.hpp"
+
+/* Received datagrams are copied out of the (reused, full-size) receive
+ * buffers into slices of big chunks, and JS gets Buffers of exactly the
+ * datagram size over those slices. A chunk goes back to the pool once
+ * every Buffer over it was garbage collected. Every slice is prefixed
+ * with its length, so the finalizer knows what it gives back.
+ *
+ * Everything in here runs on the JS thread.
+ */
+
+namespace OverTheWire::Transports::Socket {
+
+  const size_t defaultPoolChunkSize = 256 * 1024;
+  const size_t maxFreeChunks = 4;
+
+  struct RecvPoolStats {
+    size_t chunks = 0;
+    size_t freeChunks = 0;
+    size_t bytesReserved = 0;
+    size_t bytesInUse = 0;
+    size_t buffers = 0;
+  };
+
+  struct RecvPoolState;
+
+  struct RecvChunk {
+    std::unique_ptr<uint8_t[]> mem;
+    size_t size = 0;
+    size_t used = 0;
+    // one per live slice, plus one while the pool fills the chunk
+    size_t refs = 0;
+    std::shared_ptr<RecvPoolState> state;
+  };
+
+  // shared by the pool and its chunks, the chunks can outlive the socket
+  struct RecvPoolState {
+    ~RecvPoolState();
+
+    size_t chunkSize = defaultPoolChunkSize;
+    bool alive = true;
+    std::vector<RecvChunk*> free;
+    RecvPoolStats stats;
+  };
+
+  struct RecvSlice {
+    uint8_t* data = nullptr;
+    size_t len = 0;
+    RecvChunk* chunk = nullptr;
+    // UDP GRO segment size, 0 when the datagram wasn't coalesced
+    size_t segment = 0;
+  };
+
+  struct RecvPool {
+    RecvPool(size_t = defaultPoolChunkSize);
+    ~RecvPool();
+
+    void setChunkSize(size_t);
+    RecvSlice alloc(size_t);
+    RecvSlice copy(const uint8_t*, size_t);
+    RecvPoolStats stats();
+
+    static void release(uint8_t*, RecvChunk*);
+    static void unref(RecvChunk*);
+
+    RecvChunk* newChunk(size_t);
+
+    std::shared_ptr<RecvPoolState> state;
+    RecvChunk* current = nullptr;
+  };
+}
@@ -102,6 +102,22 @@ std::pair<std::string, addr_t> SockAddr::addr() {
   return std::make_pair(err, std::move(res));
 }
 
+std::pair<std::string, resolved_addr_t> SockAddr::resolved() {
+  if (!cache) {
+    std::string err;
+    addr_t raw;
+    std::tie(err, raw) = addr();
+    if (err.size() > 0) {
+      return std::make_pair(err, nullptr);
+    }
+    auto res = std::make_shared<ResolvedAddr>();
+    std::memcpy(&res->storage, raw.first.get(), raw.second);
+    res->size = raw.second;
+    cache = std::move(res);
+  }
+  return std::make_pair(std::string{}, cache);
+}
+
 //from https://github.com/libuv/libuv/pull/3368/files
 int ip_name(const struct sockaddr *src, char *dst, size_t size) {
   switch (src->sa_family) {
@@ -181,6 +197,7 @@ Napi::Value SockAddr::getPort(const Napi::CallbackInfo& info) {
 
 void SockAddr::setPort(const Napi::CallbackInfo&, const Napi::Value& val) {
   port = val.As<Napi::Number>().Int32Value();
+  cache.reset();
 }
 
 Napi::Value SockAddr::getIp(const Napi::CallbackInfo& info) {
@@ -192,6 +209,7 @@ Napi::Value SockAddr::getIp(const Napi::CallbackInfo& info) {
 
 void SockAddr::setIp(const Napi::CallbackInfo&, const Napi::Value& val) {
   ip = val.As<Napi::String>().Utf8Value();
+  cache.reset();
 }
 
 Napi::Value SockAddr::getDomain(const Napi::CallbackInfo& info) {
@@ -200,6 +218,7 @@ Napi::Value SockAddr::getDomain(const Napi::CallbackInfo& info) {
 
 void SockAddr::setDomain(const Napi::CallbackInfo&, const Napi::Value& val) {
   domain = val.As<Napi::Number>().Int32Value();
+  cache.reset();
 }
 
 };
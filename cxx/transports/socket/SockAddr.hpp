@@ -24,6 +24,15 @@ namespace OverTheWire::Transports::Socket {
   using sockaddr_ptr_t = std::unique_ptr<sockaddr>;
   using addr_t = std::pair<sockaddr_ptr_t, size_t>;
 
+  // a resolved address is immutable, queued packets share it with the SockAddr
+  struct ResolvedAddr {
+    const sockaddr* get() const { return (const sockaddr*)&storage; }
+
+    sockaddr_storage storage;
+    size_t size;
+  };
+  using resolved_addr_t = std::shared_ptr<const ResolvedAddr>;
+
   int ip_name(const struct sockaddr*, char*, size_t);
 
   struct SockAddr : public Napi::ObjectWrap<SockAddr> {
@@ -37,6 +46,7 @@ namespace OverTheWire::Transports::Socket {
     ~SockAddr();
     bool genName(Napi::Env, bool);
     std::pair<std::string, addr_t> addr();
+    std::pair<std::string, resolved_addr_t> resolved();
 
     Napi::Value toString(const Napi::CallbackInfo&);
     Napi::Value toBuffer(const Napi::CallbackInfo&);
@@ -56,6 +66,8 @@ namespace OverTheWire::Transports::Socket {
     int domain = -1;
 
     char name[INET6_ADDRSTRLEN];
+    // dropped whenever ip, port or domain change
+    resolved_addr_t cache;
   };
 
 }
@@ -1,4 +1,10 @@
 #include "Socket.hpp"
+#include "transports/pcap/Replay.hpp"
+
+#ifdef __linux__
+#include <netinet/udp.h>
+#include <linux/filter.h>
+#endif
 
 namespace OverTheWire::Transports::Socket {
 
@@ -16,7 +22,19 @@ Napi::Object Socket::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod<&Socket::connect>("connect", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&Socket::setsockopt>("setsockopt", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&Socket::getsockopt>("getsockopt", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&Socket::attachFilter>("attachFilter", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+    InstanceMethod<&Socket::detachFilter>("detachFilter", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceAccessor<&Socket::getBufferSize, &Socket::setBufferSize>("bufferSize"),
+    InstanceAccessor<&Socket::getReadBatchSize, &Socket::setReadBatchSize>("readBatchSize"),
+    InstanceAccessor<&Socket::getBatchMode, &Socket::setBatchMode>("batchMode"),
+    InstanceAccessor<&Socket::getPoolStats>("poolStats"),
+    InstanceAccessor<&Socket::getZeroCopy, &Socket::setZeroCopy>("zeroCopy"),
+    InstanceAccessor<&Socket::getZeroCopyStats>("zeroCopyStats"),
+    InstanceAccessor<&Socket::getGro, &Socket::setGro>("gro"),
+    InstanceAccessor<&Socket::getBackend>("backend"),
+    InstanceAccessor<&Socket::getQueueStats>("queueStats"),
+    InstanceAccessor<&Socket::getMaxQueuePackets, &Socket::setMaxQueuePackets>("maxQueuePackets"),
+    InstanceAccessor<&Socket::getMaxQueueBytes, &Socket::setMaxQueueBytes>("maxQueueBytes"),
     //InstanceMethod<&Socket::ioctl>("ioctl", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&Socket::toHuman>(Napi::Symbol::For(env, "nodejs.util.inspect.custom"), static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
     InstanceMethod<&Socket::close>("close", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
@@ -38,6 +56,8 @@ static void IoEvent(uv_poll_t* watcher, int status, int revents) {
 
 Socket::Socket(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Socket>{info}, packets{sendFlags, connected} {
   Napi::Env env = info.Env();
+  bool zeroCopy = false;
+  bool gro = false;
   checkLength(info, 1);
   if (info[0].IsObject()) {
     Napi::Object obj = info[0].As<Napi::Object>();
@@ -52,6 +72,44 @@ Socket::Socket(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Socket>{info},
     if (obj.Has("bufferSize")) {
       bufferSize = obj.Get("bufferSize").As<Napi::Number>().Uint32Value();
     }
+
+    if (obj.Has("poolChunkSize")) {
+      recvPool.setChunkSize(std::max<uint32_t>(obj.Get("poolChunkSize").As<Napi::Number>().Uint32Value(), 4096));
+    }
+
+    if (obj.Has("readBatchSize")) {
+      readBatchSize = std::max<uint32_t>(obj.Get("readBatchSize").As<Napi::Number>().Uint32Value(), 1);
+    }
+
+    if (obj.Has("batchMode")) {
+      batchMode = obj.Get("batchMode").ToBoolean().Value();
+    }
+
+    if (obj.Has("backend")) {
+      auto backend = obj.Get("backend").ToString().Utf8Value();
+      if (backend == "uring") {
+        uring = std::make_unique<Uring>();
+      }
+      else if (backend != "poll") {
+        Napi::Error::New(env, "Unknown backend " + backend).ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    if (obj.Has("maxQueuePackets")) {
+      maxQueuePackets = obj.Get("maxQueuePackets").As<Napi::Number>().Uint32Value();
+    }
+
+    if (obj.Has("maxQueueBytes")) {
+      maxQueueBytes = obj.Get("maxQueueBytes").As<Napi::Number>().Int64Value();
+    }
+
+    if (obj.Has("uringBuffers")) {
+      uringBuffers = std::max<uint32_t>(obj.Get("uringBuffers").As<Napi::Number>().Uint32Value(), 1);
+    }
+
+    zeroCopy = obj.Has("zeroCopy") && obj.Get("zeroCopy").ToBoolean().Value();
+    gro = obj.Has("gro") && obj.Get("gro").ToBoolean().Value();
   }
   else {
     checkLength(info, 3);
@@ -63,7 +121,42 @@ Socket::Socket(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Socket>{info},
   env.GetInstanceData<AddonData>()->GetClass(typeid(JsParent<Socket>)).Call(this->Value(), {});
 
   createSocket(env);
+  if (uring) {
+    auto err = uring->open(pollfd, bufferSize, uringBuffers, gro);
+    if (err.size() > 0) {
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+      return;
+    }
+  }
   initSocket(env);
+
+  if (zeroCopy) {
+    auto err = packets.setZeroCopy(pollfd, true);
+    if (err.size() > 0) {
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+      return;
+    }
+  }
+
+  if (gro) {
+    auto err = setGro(true);
+    if (err.size() > 0) {
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+    }
+  }
+}
+
+std::string Socket::setGro(bool on) {
+#if defined(__linux__) && defined(UDP_GRO)
+  int val = on;
+  if (::setsockopt(pollfd, SOL_UDP, UDP_GRO, &val, sizeof(val)) < 0) {
+    return getSystemError();
+  }
+  recvBatch.gro = on;
+  return "";
+#else
+  return "UDP GRO is only supported on Linux";
+#endif
 }
 
 void Socket::createSocket(Napi::Env env) {
@@ -78,7 +171,10 @@ void Socket::initSocket(Napi::Env env) {
   pollWatcher = decltype(pollWatcher){new uv_poll_t};
   pollWatcher->data = this;
   
-  int initResult = uv_poll_init_socket(uv_default_loop(), pollWatcher.get(), pollfd);
+  // the io_uring backend only waits for its completion eventfd
+  int initResult = uring
+    ? uv_poll_init(uv_default_loop(), pollWatcher.get(), uring->eventFd)
+    : uv_poll_init_socket(uv_default_loop(), pollWatcher.get(), pollfd);
   if (initResult != 0) {
     Napi::Error::New(env, getLibuvError(initResult)).ThrowAsJavaScriptException();
     return;
@@ -86,7 +182,9 @@ void Socket::initSocket(Napi::Env env) {
 }
 
 void Socket::pollStart() {
-  int startResult = uv_poll_start(pollWatcher.get(), flags, IoEvent);
+  // with io_uring reads and writes both complete on the eventfd
+  int events = uring ? (flags != 0 ? UV_READABLE : 0) : flags;
+  int startResult = uv_poll_start(pollWatcher.get(), events, IoEvent);
   if (startResult != 0) {
     Napi::Error::New(Env(), getLibuvError(startResult)).ThrowAsJavaScriptException();
     return;
@@ -154,12 +252,83 @@ Napi::Value Socket::connect(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+bool Socket::isProgramOpt(int level, int optname) {
+#ifdef __linux__
+  return level == SOL_SOCKET && (optname == SO_ATTACH_FILTER || optname == SO_ATTACH_REUSEPORT_CBPF);
+#else
+  return false;
+#endif
+}
+
+std::string Socket::attachProgram(int optname, const uint8_t* insns, size_t size) {
+#ifdef __linux__
+  // the option takes a pointer to the instructions, which JS can't pass in a buffer
+  if (size == 0 || size % sizeof(sock_filter) != 0 || size / sizeof(sock_filter) > BPF_MAXINSNS) {
+    return "Expected a buffer of up to " + std::to_string(BPF_MAXINSNS) + " sock_filter instructions";
+  }
+  sock_fprog fprog{};
+  fprog.len = size / sizeof(sock_filter);
+  fprog.filter = (sock_filter*)insns;
+  if (::setsockopt(pollfd, SOL_SOCKET, optname, &fprog, sizeof(fprog)) < 0) {
+    return getSystemError();
+  }
+  return "";
+#else
+  return "Socket filters are only supported on Linux";
+#endif
+}
+
+Napi::Value Socket::attachFilter(const Napi::CallbackInfo& info) {
+  checkLength(info, 1);
+  if (!info[0].IsBuffer()) {
+    Napi::Error::New(info.Env(), "Expected the filter bytecode").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+#ifdef __linux__
+  js_buffer_t buf = info[0].As<js_buffer_t>();
+  auto err = attachProgram(SO_ATTACH_FILTER, buf.Data(), buf.Length());
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), "Could not attach filter: " + err).ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  // a locked filter can't be replaced or removed for the life of the socket
+  bool lock = info.Length() > 1 && info[1].ToBoolean();
+  int val = 1;
+  if (lock && ::setsockopt(pollfd, SOL_SOCKET, SO_LOCK_FILTER, &val, sizeof(val)) < 0) {
+    Napi::Error::New(info.Env(), "Could not lock filter: " + getSystemError()).ThrowAsJavaScriptException();
+  }
+#else
+  Napi::Error::New(info.Env(), "Socket filters are only supported on Linux").ThrowAsJavaScriptException();
+#endif
+  return info.Env().Undefined();
+}
+
+Napi::Value Socket::detachFilter(const Napi::CallbackInfo& info) {
+#ifdef __linux__
+  int val = 0;
+  if (::setsockopt(pollfd, SOL_SOCKET, SO_DETACH_FILTER, &val, sizeof(val)) < 0) {
+    Napi::Error::New(info.Env(), "Could not detach filter: " + getSystemError()).ThrowAsJavaScriptException();
+  }
+#else
+  Napi::Error::New(info.Env(), "Socket filters are only supported on Linux").ThrowAsJavaScriptException();
+#endif
+  return info.Env().Undefined();
+}
+
 Napi::Value Socket::setsockopt(const Napi::CallbackInfo& info) {
   checkLength(info, 3);
   int level = info[0].As<Napi::Number>().Int32Value();
   int optname = info[1].As<Napi::Number>().Int32Value();
   int result = 0;
-  if (info[2].IsBuffer()) {
+  if (info[2].IsBuffer() && isProgramOpt(level, optname)) {
+    js_buffer_t buf = info[2].As<js_buffer_t>();
+    auto err = attachProgram(optname, buf.Data(), buf.Length());
+    if (err.size() > 0) {
+      Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+    }
+  }
+  else if (info[2].IsBuffer()) {
     js_buffer_t buf = info[2].As<js_buffer_t>();
     result = ::setsockopt(pollfd, level, optname, (SOCKET_OPT_TYPE)buf.Data(), buf.Length());
   }
@@ -228,6 +397,13 @@ Napi::Value Socket::ioctl(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value Socket::resume(const Napi::CallbackInfo& info) {
+  if (uring) {
+    auto err = uring->armRecv(!connected);
+    if (err.size() > 0) {
+      Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
   setFlag(UV_READABLE, true);
   pollStart();
   refForRead();
@@ -235,6 +411,9 @@ Napi::Value Socket::resume(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value Socket::pause(const Napi::CallbackInfo& info) {
+  if (uring) {
+    uring->cancelRecv();
+  }
   setFlag(UV_READABLE, false);
   pollStart();
   unrefForRead();
@@ -267,36 +446,35 @@ void Socket::handleIOEvent(int status, int revents) {
   Napi::Function emit = self.Get("emit").As<Napi::Function>();
 
   if (status < 0) {
+    // zero-copy completions raise POLLERR, libuv reports it as EBADF and stops the handle
+    if (status == UV_EBADF && packets.zeroCopy) {
+      reapZeroCopy(emit);
+      return;
+    }
     emit.MakeCallback(Value(), { Napi::String::New(Env(), "error"), Napi::String::New(emit.Env(), getLibuvError(status)) }, nullptr);
     return;
   }
 
-  if (revents & UV_READABLE) {
-    InputPacketReader reader{pollfd, bufferSize, !connected};
+  if (uring) {
+    handleUringEvent(emit);
+  }
+  else if (revents & UV_READABLE && batchMode) {
+    emitBatch(emit);
+  }
+  else if (revents & UV_READABLE) {
+    InputPacketReader reader{pollfd, bufferSize, !connected, readBatchSize, recvBatch, recvPool};
     for (auto& packet : reader) {
       if (packet.pErr.size() > 0) {
         emit.MakeCallback(Value(), { Napi::String::New(Env(), "error"), Napi::String::New(emit.Env(), packet.pErr) }, nullptr);
         break;
       }
 
-      if (!packet.pData.pBuf.first.get()) {
+      auto& slice = packet.pData.pBuf;
+      if (!slice.data) {
         break;
       }
 
-      auto buf = js_buffer_t::NewOrCopy(Env(), (uint8_t*)packet.pData.pBuf.first.release(), packet.pData.pBuf.second, [](Napi::Env env, uint8_t* data) { 
-        DEBUG_OUTPUT("Deleting packet buffer");
-        delete data; 
-      });
-
-      Napi::Value addr;
-      if (packet.pData.pAddr.first.get()) {
-        addr = SockAddr::fromRaw(Env(), std::move(packet.pData.pAddr));
-      }
-      else {
-        addr = Env().Undefined();
-      }
-
-      emit.MakeCallback(Value(), { Napi::String::New(Env(), "data"), buf, addr }, nullptr);
+      emitData(emit, slice, std::move(packet.pData.pAddr));
     }
   }
   else if (revents & UV_WRITABLE) {
@@ -306,8 +484,12 @@ void Socket::handleIOEvent(int status, int revents) {
       case SendStatus::ok:
         DEBUG_OUTPUT("SendStatus is ok");
         setFlag(UV_WRITABLE, false);
+        // keeps the fd polled, so the completions are noticed
+        setFlag(UV_DISCONNECT, packets.inflight.size() > 0);
         pollStart();
-        unrefForWrite();
+        if (packets.inflight.empty()) {
+          unrefForWrite();
+        }
         emit.MakeCallback(Value(), { Napi::String::New(Env(), "drain") }, nullptr);
         break;
       case SendStatus::fail:
@@ -323,14 +505,214 @@ void Socket::handleIOEvent(int status, int revents) {
 
 }
 
-bool Socket::processReq(Napi::Env& env, const Napi::Value&& inputBuf, const Napi::Object&& inputAddr) {
+void Socket::emitData(Napi::Function& emit, const RecvSlice& slice, addr_t&& peer) {
+  // exactly the datagram, a slice of a pooled chunk
+  auto buf = js_buffer_t::NewOrCopy(Env(), slice.data, slice.len, [](Napi::Env env, uint8_t* data, RecvChunk* chunk) { 
+    DEBUG_OUTPUT("Releasing packet buffer");
+    RecvPool::release(data, chunk);
+  }, slice.chunk);
+
+  Napi::Value addr;
+  if (peer.first.get()) {
+    addr = SockAddr::fromRaw(Env(), std::move(peer));
+  }
+  else {
+    addr = Env().Undefined();
+  }
+
+  if (slice.segment > 0) {
+    emit.MakeCallback(Value(), { Napi::String::New(Env(), "data"), buf, addr, Napi::Number::New(Env(), slice.segment) }, nullptr);
+  }
+  else {
+    emit.MakeCallback(Value(), { Napi::String::New(Env(), "data"), buf, addr }, nullptr);
+  }
+}
+
+void Socket::handleUringEvent(Napi::Function& emit) {
+  Napi::Env env = Env();
+  auto& events = uring->reap();
+
+  if (batchMode && events.datagrams.size() > 0) {
+    socketBatch.clear();
+    for (auto& d : events.datagrams) {
+      socketBatch.add(d.slice, d.addr);
+    }
+    auto arena = socketBatch.pack(recvPool);
+    uring->recycle();
+
+    auto buf = js_buffer_t::NewOrCopy(env, arena.data, arena.len, [](Napi::Env env, uint8_t* data, RecvChunk* chunk) { 
+      DEBUG_OUTPUT("Releasing batch buffer");
+      RecvPool::release(data, chunk);
+    }, arena.chunk);
+    auto meta = Napi::Uint32Array::New(env, socketBatch.meta.size());
+    std::memcpy(meta.Data(), socketBatch.meta.data(), socketBatch.meta.size() * sizeof(uint32_t));
+    auto addrs = js_buffer_t::Copy(env, socketBatch.addrs.data(), socketBatch.addrs.size());
+    socketBatch.clear();
+
+    emit.MakeCallback(Value(), { Napi::String::New(env, "batch"), buf, meta, addrs }, nullptr);
+  }
+  else if (events.datagrams.size() > 0) {
+    // copied out first, so the ring gets its buffers back before any JS runs
+    std::vector<std::pair<RecvSlice, addr_t>> received;
+    received.reserve(events.datagrams.size());
+    for (auto& d : events.datagrams) {
+      auto slice = recvPool.copy(d.slice.data, d.slice.len);
+      slice.segment = d.slice.segment;
+      addr_t peer{nullptr, 0};
+      if (d.addr) {
+        peer.first = sockaddr_ptr_t{(sockaddr*)new sockaddr_storage};
+        std::memcpy(peer.first.get(), d.addr, sizeof(sockaddr_storage));
+        peer.second = sizeof(sockaddr_storage);
+      }
+      received.emplace_back(slice, std::move(peer));
+    }
+    uring->recycle();
+
+    for (auto& [slice, peer] : received) {
+      emitData(emit, slice, std::move(peer));
+    }
+  }
+
+  std::string recvErr = events.recvErr;
+  std::string sendErr = events.sendErr;
+
+  // the multishot recv ends when the ring runs dry, it's rearmed as long as we read
+  if (getFlag(UV_READABLE) && recvErr.size() == 0 && !uring->recvArmed) {
+    recvErr = uring->armRecv(!connected);
+  }
+
+  bool drained = getFlag(UV_WRITABLE) && uring->pendingSends() == 0;
+  if (drained) {
+    setFlag(UV_WRITABLE, false);
+    unrefForWrite();
+  }
+  pollStart();
+
+  if (recvErr.size() > 0) {
+    emit.MakeCallback(Value(), { Napi::String::New(env, "error"), Napi::String::New(env, recvErr) }, nullptr);
+  }
+  if (sendErr.size() > 0) {
+    emit.MakeCallback(Value(), { Napi::String::New(env, "error"), Napi::String::New(env, sendErr) }, nullptr);
+  }
+  if (drained) {
+    emit.MakeCallback(Value(), { Napi::String::New(env, "drain") }, nullptr);
+  }
+}
+
+void Socket::reapZeroCopy(Napi::Function& emit) {
+  Napi::Env env = Env();
+  std::string err;
+  size_t completed, copied;
+  std::tie(completed, copied) = packets.reap(pollfd, err);
+
+  if (err.size() == 0) {
+    // a pending socket error raises POLLERR too
+    int soErr = 0;
+    SOCKET_LEN_TYPE len = sizeof(soErr);
+    if (::getsockopt(pollfd, SOL_SOCKET, SO_ERROR, (SOCKET_OPT_TYPE)&soErr, &len) == 0 && soErr != 0) {
+      err = std::strerror(soErr);
+    }
+  }
+
+  if (packets.inflight.empty()) {
+    setFlag(UV_DISCONNECT, false);
+    if (!getFlag(UV_WRITABLE)) {
+      unrefForWrite();
+    }
+  }
+  pollStart();
+
+  if (completed > 0) {
+    Napi::Object res = Napi::Object::New(env);
+    res.Set("packets", Napi::Number::New(env, completed));
+    res.Set("copied", Napi::Number::New(env, copied));
+    emit.MakeCallback(Value(), { Napi::String::New(env, "zerocopy"), res }, nullptr);
+  }
+  if (err.size() > 0) {
+    emit.MakeCallback(Value(), { Napi::String::New(env, "error"), Napi::String::New(env, err) }, nullptr);
+  }
+}
+
+void Socket::emitBatch(Napi::Function& emit) {
+  Napi::Env env = Env();
+  std::string err;
+
+  // the datagrams stay in the scratch buffers until they are packed
+  InputPacketReader reader{pollfd, bufferSize, !connected, readBatchSize, recvBatch, recvPool, false};
+  socketBatch.clear();
+  for (auto& packet : reader) {
+    if (packet.pErr.size() > 0) {
+      err = packet.pErr;
+      break;
+    }
+
+    auto& slice = packet.pData.pBuf;
+    if (!slice.data) {
+      break;
+    }
+    socketBatch.add(slice, packet.pData.pAddr.first.get());
+  }
+
+  if (socketBatch.size() > 0) {
+    auto arena = socketBatch.pack(recvPool);
+    auto buf = js_buffer_t::NewOrCopy(env, arena.data, arena.len, [](Napi::Env env, uint8_t* data, RecvChunk* chunk) { 
+      DEBUG_OUTPUT("Releasing batch buffer");
+      RecvPool::release(data, chunk);
+    }, arena.chunk);
+
+    auto meta = Napi::Uint32Array::New(env, socketBatch.meta.size());
+    std::memcpy(meta.Data(), socketBatch.meta.data(), socketBatch.meta.size() * sizeof(uint32_t));
+    auto addrs = js_buffer_t::Copy(env, socketBatch.addrs.data(), socketBatch.addrs.size());
+    socketBatch.clear();
+
+    emit.MakeCallback(Value(), { Napi::String::New(env, "batch"), buf, meta, addrs }, nullptr);
+  }
+
+  if (err.size() > 0) {
+    emit.MakeCallback(Value(), { Napi::String::New(env, "error"), Napi::String::New(env, err) }, nullptr);
+  }
+}
+
+size_t Socket::queuedPackets() {
+  return packets.size() + (uring ? uring->pendingSends() : 0);
+}
+
+size_t Socket::queuedBytes() {
+  return packets.bytes + (uring ? uring->pendingBytes() : 0);
+}
+
+bool Socket::queueFull(size_t size) {
+  return (maxQueuePackets > 0 && queuedPackets() + (size > 0 ? 1 : 0) > maxQueuePackets) ||
+    (maxQueueBytes > 0 && queuedBytes() + size > maxQueueBytes);
+}
+
+bool Socket::processReq(Napi::Env& env, const Napi::Value&& inputBuf, const Napi::Object&& inputAddr, uint16_t segment, size_t queued) {
   size_t size;
   uint8_t* buf;
 
-  std::tie(buf, size) = toCxx(inputBuf);
+  std::tie(buf, size) = toCxxView(inputBuf);
+  if (env.IsExceptionPending()) {
+    return false;
+  }
+
+  if (queueFull(std::max<size_t>(size, 1))) {
+    auto err = Napi::Error::New(env, "Send queue is full");
+    err.Set("code", Napi::String::New(env, "ENOBUFS"));
+    // packets before this one in the same write() are queued
+    err.Set("queued", Napi::Number::New(env, queued));
+    err.ThrowAsJavaScriptException();
+    return false;
+  }
   SockAddr* addr = Napi::ObjectWrap<SockAddr>::Unwrap(inputAddr);
 
-  if (!packets.add(buf, size, addr)) {
+#ifndef __linux__
+  if (segment > 0) {
+    Napi::Error::New(env, "UDP segmentation offload is only supported on Linux").ThrowAsJavaScriptException();
+    return false;
+  }
+#endif
+
+  if (!packets.add(buf, size, addr, inputBuf, segment)) {
     Napi::Error::New(env, "Error queueing packet").ThrowAsJavaScriptException();
     return false;
   }
@@ -338,6 +720,13 @@ bool Socket::processReq(Napi::Env& env, const Napi::Value&& inputBuf, const Napi
   return true;
 }
 
+static uint16_t segmentSize(const Napi::Value& val) {
+  if (!val.IsNumber()) {
+    return 0;
+  }
+  return std::min<uint32_t>(val.As<Napi::Number>().Uint32Value(), UINT16_MAX);
+}
+
 Napi::Value Socket::write(const Napi::CallbackInfo& info) {
   checkLength(info, 1);
   Napi::Env env = info.Env();
@@ -349,18 +738,33 @@ Napi::Value Socket::write(const Napi::CallbackInfo& info) {
 
       if (nestedAr.Length() < 2) {
         Napi::Error::New(env, "Error queueing packet").ThrowAsJavaScriptException();
-        return env.Undefined();
+        break;
       }
 
-      bool ok = processReq(env, nestedAr.Get("0").As<Napi::Object>(), nestedAr.Get("1").As<Napi::Object>());
+      uint16_t segment = nestedAr.Length() > 2 ? segmentSize(nestedAr.Get("2")) : 0;
+      bool ok = processReq(env, nestedAr.Get("0").As<Napi::Object>(), nestedAr.Get("1").As<Napi::Object>(), segment, i);
       if (!ok) {
-        return env.Undefined();
+        break;
       }
     }
   }
   else {
-    bool ok = processReq(env, info[0], info[1].As<Napi::Object>());
-    if (!ok) {
+    uint16_t segment = info.Length() > 2 ? segmentSize(info[2]) : 0;
+    processReq(env, info[0], info[1].As<Napi::Object>(), segment);
+  }
+
+  // whatever got queued goes out, even if a later packet was refused
+  if (packets.size() == 0) {
+    return env.Undefined();
+  }
+
+  if (uring) {
+    // submitted right away, the completions come through the eventfd
+    auto err = uring->send(packets);
+    if (err.size() > 0 && !env.IsExceptionPending()) {
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+    }
+    if (uring->pendingSends() == 0) {
       return env.Undefined();
     }
   }
@@ -373,7 +777,7 @@ Napi::Value Socket::write(const Napi::CallbackInfo& info) {
   refForWrite();
   DEBUG_OUTPUT((std::stringstream{} << "writeRefsCount is " << writeRefsCount).str());
 
-  return env.Undefined();
+  return Napi::Boolean::New(env, !queueFull(1));
 }
 
 void Socket::refForRead() {
@@ -405,9 +809,16 @@ void Socket::unrefForWrite() {
 }
 
 void Socket::close() {
+  for (auto* replay : std::set<Pcap::Replay*>{replays}) {
+    replay->halt();
+  }
+  closed = true;
   if (pollWatcher.get()) {
     uv_poll_stop(pollWatcher.get());
   }
+  if (uring) {
+    uring->close();
+  }
   if (pollfd > 0) {
     ::closesocket(pollfd);
   }
@@ -421,6 +832,98 @@ void Socket::setBufferSize(const Napi::CallbackInfo&, const Napi::Value& val) {
   bufferSize = val.As<Napi::Number>().Uint32Value();
 }
 
+Napi::Value Socket::getPoolStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  auto stats = recvPool.stats();
+  Napi::Object res = Napi::Object::New(env);
+  res.Set("chunks", Napi::Number::New(env, stats.chunks));
+  res.Set("freeChunks", Napi::Number::New(env, stats.freeChunks));
+  res.Set("bytesReserved", Napi::Number::New(env, stats.bytesReserved));
+  res.Set("bytesInUse", Napi::Number::New(env, stats.bytesInUse));
+  res.Set("buffers", Napi::Number::New(env, stats.buffers));
+  return res;
+}
+
+Napi::Value Socket::getReadBatchSize(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), readBatchSize);
+}
+
+void Socket::setReadBatchSize(const Napi::CallbackInfo&, const Napi::Value& val) {
+  readBatchSize = std::max<uint32_t>(val.As<Napi::Number>().Uint32Value(), 1);
+}
+
+Napi::Value Socket::getBatchMode(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), batchMode);
+}
+
+void Socket::setBatchMode(const Napi::CallbackInfo&, const Napi::Value& val) {
+  batchMode = val.ToBoolean().Value();
+}
+
+Napi::Value Socket::getQueueStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object res = Napi::Object::New(env);
+  res.Set("packets", Napi::Number::New(env, queuedPackets()));
+  res.Set("bytes", Napi::Number::New(env, queuedBytes()));
+  res.Set("maxPackets", Napi::Number::New(env, maxQueuePackets));
+  res.Set("maxBytes", Napi::Number::New(env, maxQueueBytes));
+  return res;
+}
+
+Napi::Value Socket::getMaxQueuePackets(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), maxQueuePackets);
+}
+
+void Socket::setMaxQueuePackets(const Napi::CallbackInfo&, const Napi::Value& val) {
+  maxQueuePackets = val.As<Napi::Number>().Uint32Value();
+}
+
+Napi::Value Socket::getMaxQueueBytes(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), maxQueueBytes);
+}
+
+void Socket::setMaxQueueBytes(const Napi::CallbackInfo&, const Napi::Value& val) {
+  maxQueueBytes = val.As<Napi::Number>().Int64Value();
+}
+
+Napi::Value Socket::getBackend(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(), uring ? "uring" : "poll");
+}
+
+Napi::Value Socket::getGro(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), recvBatch.gro);
+}
+
+void Socket::setGro(const Napi::CallbackInfo& info, const Napi::Value& val) {
+  auto err = setGro(val.ToBoolean().Value());
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value Socket::getZeroCopy(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), packets.zeroCopy);
+}
+
+void Socket::setZeroCopy(const Napi::CallbackInfo& info, const Napi::Value& val) {
+  auto err = packets.setZeroCopy(pollfd, val.ToBoolean().Value());
+  if (err.size() > 0) {
+    Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value Socket::getZeroCopyStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  auto& stats = packets.zeroCopyStats;
+  Napi::Object res = Napi::Object::New(env);
+  res.Set("sent", Napi::Number::New(env, stats.sent));
+  res.Set("completed", Napi::Number::New(env, stats.completed));
+  res.Set("zeroCopied", Napi::Number::New(env, stats.completed - stats.copied));
+  res.Set("copied", Napi::Number::New(env, stats.copied));
+  res.Set("inflight", Napi::Number::New(env, packets.inflight.size()));
+  return res;
+}
+
 Napi::Value Socket::close(const Napi::CallbackInfo& info) {
   close();
   return info.Env().Undefined();
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <iostream>
+#include <set>
 #include <uv.h>
 
 #include "common.hpp"
 #include "Packets.hpp"
 #include "InputPackets.hpp"
+#include "SocketBatch.hpp"
+#include "Uring.hpp"
 #include "error/Error.hpp"
 #include "SockAddr.hpp"
 #include "Enums/Enums.hpp"
@@ -14,6 +17,10 @@
  * This is quite hard.
  */
 
+namespace OverTheWire::Transports::Pcap {
+  struct Replay;
+}
+
 namespace OverTheWire::Transports::Socket {
 
   Napi::Object Init(Napi::Env env, Napi::Object exports);
@@ -27,11 +34,21 @@ namespace OverTheWire::Transports::Socket {
     void initSocket(Napi::Env);
     void pollStart();
     void handleIOEvent(int, int);
+    void emitBatch(Napi::Function&);
+    void reapZeroCopy(Napi::Function&);
+    void handleUringEvent(Napi::Function&);
+    void emitData(Napi::Function&, const RecvSlice&, addr_t&&);
     void setFlag(int, bool);
     void close();
     bool getFlag(int);
 
-    bool processReq(Napi::Env&, const Napi::Value&&, const Napi::Object&&);
+    bool processReq(Napi::Env&, const Napi::Value&&, const Napi::Object&&, uint16_t = 0, size_t = 0);
+    size_t queuedPackets();
+    size_t queuedBytes();
+    bool queueFull(size_t);
+    std::string setGro(bool);
+    static bool isProgramOpt(int, int);
+    std::string attachProgram(int, const uint8_t*, size_t);
 
     Napi::Value resume(const Napi::CallbackInfo&);
     Napi::Value pause(const Napi::CallbackInfo&);
@@ -40,11 +57,29 @@ namespace OverTheWire::Transports::Socket {
     Napi::Value connect(const Napi::CallbackInfo&);
     Napi::Value setsockopt(const Napi::CallbackInfo&);
     Napi::Value getsockopt(const Napi::CallbackInfo&);
+    Napi::Value attachFilter(const Napi::CallbackInfo&);
+    Napi::Value detachFilter(const Napi::CallbackInfo&);
     Napi::Value ioctl(const Napi::CallbackInfo&);
     Napi::Value toHuman(const Napi::CallbackInfo&);
 
     Napi::Value getBufferSize(const Napi::CallbackInfo&);
     void setBufferSize(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getPoolStats(const Napi::CallbackInfo&);
+    Napi::Value getReadBatchSize(const Napi::CallbackInfo&);
+    void setReadBatchSize(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getBatchMode(const Napi::CallbackInfo&);
+    void setBatchMode(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getBackend(const Napi::CallbackInfo&);
+    Napi::Value getQueueStats(const Napi::CallbackInfo&);
+    Napi::Value getMaxQueuePackets(const Napi::CallbackInfo&);
+    void setMaxQueuePackets(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getMaxQueueBytes(const Napi::CallbackInfo&);
+    void setMaxQueueBytes(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getGro(const Napi::CallbackInfo&);
+    void setGro(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getZeroCopy(const Napi::CallbackInfo&);
+    void setZeroCopy(const Napi::CallbackInfo&, const Napi::Value&);
+    Napi::Value getZeroCopyStats(const Napi::CallbackInfo&);
 
     void refForRead();
     void refForWrite();
@@ -61,7 +96,21 @@ namespace OverTheWire::Transports::Socket {
     int protocol;
     int pollFlags = 0;
     size_t bufferSize = defaultBufferSize;
+    size_t readBatchSize = defaultReadBatchSize;
+    // 0 is unlimited
+    size_t maxQueuePackets = 0;
+    size_t maxQueueBytes = 0;
+    bool batchMode = false;
+    RecvBatch recvBatch;
+    SocketBatch socketBatch;
+    // set when the socket runs on the io_uring backend
+    std::unique_ptr<Uring> uring;
+    unsigned uringBuffers = defaultUringBuffers;
+    RecvPool recvPool;
     SOCKET pollfd = 0;
+    bool closed = false;
+    // they send on pollfd from threads of their own
+    std::set<Pcap::Replay*> replays;
     std::unique_ptr<uv_poll_t> pollWatcher;
     size_t writeRefsCount = 0;
     size_t readRefsCount = 0;
@@ -0,0 +1,96 @@
+#include "SocketBatch.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/if_packet.h>
+#endif
+
+namespace OverTheWire::Transports::Socket {
+
+static void compactAddr(const sockaddr* sa, uint8_t* entry) {
+  uint16_t family = sa->sa_family;
+  uint16_t port = 0;
+  std::memset(entry, 0, SocketBatch::addrEntrySize);
+
+  if (family == AF_INET) {
+    auto* in = (const sockaddr_in*)sa;
+    port = ntohs(in->sin_port);
+    entry[4] = 4;
+    std::memcpy(entry + 8, &in->sin_addr, 4);
+  }
+  else if (family == AF_INET6) {
+    auto* in6 = (const sockaddr_in6*)sa;
+    port = ntohs(in6->sin6_port);
+    entry[4] = 16;
+    std::memcpy(entry + 8, &in6->sin6_addr, 16);
+  }
+#ifdef __linux__
+  else if (family == AF_PACKET) {
+    auto* ll = (const sockaddr_ll*)sa;
+    port = ntohs(ll->sll_protocol);
+    // everything after sll_protocol is exactly 16 bytes
+    std::memcpy(entry + 8, &ll->sll_ifindex, 16);
+  }
+#endif
+
+  entry[0] = family >> 8;
+  entry[1] = family & 0xff;
+  entry[2] = port >> 8;
+  entry[3] = port & 0xff;
+}
+
+uint32_t SocketBatch::addrIndex(const sockaddr* sa) {
+  if (!sa) {
+    return noAddr;
+  }
+
+  uint8_t entry[addrEntrySize];
+  compactAddr(sa, entry);
+
+  // a wakeup usually brings datagrams from a handful of peers,
+  // the latest one is the most likely to repeat
+  size_t n = addrs.size() / addrEntrySize;
+  for (size_t i = n; i > 0; --i) {
+    if (std::memcmp(addrs.data() + (i - 1) * addrEntrySize, entry, addrEntrySize) == 0) {
+      return i - 1;
+    }
+  }
+
+  addrs.insert(addrs.end(), entry, entry + addrEntrySize);
+  return n;
+}
+
+void SocketBatch::add(const RecvSlice& slice, const sockaddr* sa) {
+  meta.insert(meta.end(), {
+    (uint32_t)bytes,
+    (uint32_t)slice.len,
+    addrIndex(sa),
+    (uint32_t)slice.segment,
+  });
+  slices.push_back(slice);
+  bytes += slice.len;
+}
+
+RecvSlice SocketBatch::pack(RecvPool& pool) {
+  auto arena = pool.alloc(bytes);
+  size_t off = 0;
+  for (auto& slice : slices) {
+    std::memcpy(arena.data + off, slice.data, slice.len);
+    off += slice.len;
+  }
+  return arena;
+}
+
+size_t SocketBatch::size() const {
+  return meta.size() / fields;
+}
+
+void SocketBatch::clear() {
+  slices.clear();
+  meta.clear();
+  addrs.clear();
+  bytes = 0;
+}
+
+}
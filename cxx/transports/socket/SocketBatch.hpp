@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.hpp"
+#include "Sys.hpp"
+#include "RecvPool.hpp"
+
+/* Everything read on one readable wakeup, packed for a single 'batch' event:
+ * the datagrams back to back in one pooled slice, SocketBatch::fields numbers
+ * per datagram in the meta table and a table of the distinct peers.
+ * lib/socketBatch.js reads the same layout.
+ *
+ * A peer entry is addrEntrySize bytes, the numbers are big endian:
+ *   0  uint16 family
+ *   2  uint16 port (sll_protocol for AF_PACKET)
+ *   4  uint8  ip length, 4 or 16, 0 when the address is not an ip
+ *   8  16 bytes of address (ifindex, hatype, pkttype, halen and
+ *      sll_addr for AF_PACKET)
+ */
+
+namespace OverTheWire::Transports::Socket {
+
+  struct SocketBatch {
+    enum Field : size_t { offset, length, addr, segment, fields };
+    static const size_t addrEntrySize = 24;
+    static const uint32_t noAddr = 0xffffffff;
+
+    void add(const RecvSlice&, const sockaddr*);
+    uint32_t addrIndex(const sockaddr*);
+    RecvSlice pack(RecvPool&);
+    size_t size() const;
+    void clear();
+
+    std::vector<RecvSlice> slices;
+    std::vector<uint32_t> meta;
+    std::vector<uint8_t> addrs;
+    size_t bytes = 0;
+  };
+}
@@ -0,0 +1,474 @@
+#include "Uring.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <netinet/udp.h>
+#include "error/Error.hpp"
+#endif
+
+namespace OverTheWire::Transports::Socket {
+
+#ifdef __linux__
+
+// the low two bits of user_data tell what completed, sends keep their batch above them
+enum : uint64_t { recvTag = 1, cancelTag = 2, sendTag = 3, tagMask = 3 };
+
+static int uringSetup(unsigned entries, io_uring_params* p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int uringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+template <typename T>
+static T loadAcquire(const T* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+static void storeRelease(T* p, T v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static void* mapRing(int fd, size_t size, off_t offset) {
+  void* res = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return res == MAP_FAILED ? nullptr : res;
+}
+
+Uring::~Uring() {
+  close();
+  if (sqes) munmap(sqes, sqesSize);
+  if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+  if (sqRing) munmap(sqRing, sqRingSize);
+  if (bufRing) munmap(bufRing, bufRingSize);
+  if (bufMem) munmap(bufMem, bufMemSize);
+}
+
+std::string Uring::open(SOCKET fd, size_t bufSize, unsigned buffers, bool gro) {
+  sock = fd;
+
+  io_uring_params params{};
+  params.flags = IORING_SETUP_CQSIZE;
+  // every queued packet may complete before JS gets to reap
+  params.cq_entries = defaultUringEntries * 16;
+  ringFd = uringSetup(defaultUringEntries, &params);
+  if (ringFd < 0) {
+    return "io_uring_setup: " + getSystemError();
+  }
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+
+  sqRing = mapRing(ringFd, sqRingSize, IORING_OFF_SQ_RING);
+  if (!sqRing) {
+    return getSystemError();
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cqRing = sqRing;
+  }
+  else {
+    cqRing = mapRing(ringFd, cqRingSize, IORING_OFF_CQ_RING);
+    if (!cqRing) {
+      return getSystemError();
+    }
+  }
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = (io_uring_sqe*)mapRing(ringFd, sqesSize, IORING_OFF_SQES);
+  if (!sqes) {
+    return getSystemError();
+  }
+
+  auto* sq = (uint8_t*)sqRing;
+  sqHead = (unsigned*)(sq + params.sq_off.head);
+  sqTail = (unsigned*)(sq + params.sq_off.tail);
+  sqArray = (unsigned*)(sq + params.sq_off.array);
+  sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  sqEntries = params.sq_entries;
+  sqLocalTail = *sqTail;
+
+  auto* cq = (uint8_t*)cqRing;
+  cqHead = (unsigned*)(cq + params.cq_off.head);
+  cqTail = (unsigned*)(cq + params.cq_off.tail);
+  cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+  cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+
+  eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (eventFd < 0) {
+    return getSystemError();
+  }
+  if (uringRegister(ringFd, IORING_REGISTER_EVENTFD, &eventFd, 1) < 0) {
+    return "IORING_REGISTER_EVENTFD: " + getSystemError();
+  }
+
+  // every buffer is [io_uring_recvmsg_out][name][control][payload]
+  recvMsg = msghdr{};
+  recvMsg.msg_namelen = sizeof(sockaddr_storage);
+  recvMsg.msg_controllen = gro ? CMSG_SPACE(sizeof(int)) : 0;
+  bufSlot = sizeof(io_uring_recvmsg_out) + recvMsg.msg_namelen + recvMsg.msg_controllen + bufSize;
+  bufSlot = (bufSlot + 63) & ~size_t{63};
+
+  // the ring has to be a power of two
+  bufCount = 1;
+  while (bufCount < std::max(buffers, 1u) && bufCount < (1u << 15)) {
+    bufCount <<= 1;
+  }
+
+  bufRingSize = bufCount * sizeof(io_uring_buf);
+  void* ringMem = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (ringMem == MAP_FAILED) {
+    return getSystemError();
+  }
+  bufRing = (io_uring_buf_ring*)ringMem;
+
+  bufMemSize = bufCount * bufSlot;
+  void* mem = mmap(nullptr, bufMemSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (mem == MAP_FAILED) {
+    return getSystemError();
+  }
+  bufMem = (uint8_t*)mem;
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr = (uint64_t)bufRing;
+  reg.ring_entries = bufCount;
+  reg.bgid = 0;
+  if (uringRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    return "IORING_REGISTER_PBUF_RING: " + getSystemError();
+  }
+
+  bufTail = 0;
+  for (unsigned i{}; i < bufCount; ++i) {
+    provide(i);
+  }
+  publish();
+  return "";
+}
+
+io_uring_sqe* Uring::sqe(uint64_t batch, size_t bytes) {
+  if (sqLocalTail - loadAcquire(sqHead) >= sqEntries) {
+    // full, hand what we have to the kernel first
+    if (submit().size() > 0) {
+      return nullptr;
+    }
+  }
+  unsigned idx = sqLocalTail & sqMask;
+  io_uring_sqe* res = &sqes[idx];
+  std::memset(res, 0, sizeof(*res));
+  sqArray[idx] = idx;
+  sqLocalTail++;
+  toSubmit++;
+  prepared.push_back({batch, bytes});
+  return res;
+}
+
+std::string Uring::submit() {
+  storeRelease(sqTail, sqLocalTail);
+  while (toSubmit > 0) {
+    int res = uringEnter(ringFd, toSubmit, 0, 0);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // what's left stays in the ring, the next submit() hands it over
+      if (errno == EAGAIN || errno == EBUSY) {
+        // short on resources or on room for completions, the eventfd brings
+        // us back to reap() and pump() even with nothing in flight
+        uint64_t one = 1;
+        while (write(eventFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+        return "";
+      }
+      return "io_uring_enter: " + getSystemError();
+    }
+    toSubmit -= res;
+    submitted(res);
+  }
+  return "";
+}
+
+// the kernel takes SQEs in ring order, only those count as in flight
+void Uring::submitted(unsigned n) {
+  for (unsigned i{}; i < n && !prepared.empty(); ++i) {
+    auto sqe = prepared.front();
+    prepared.pop_front();
+    if (sqe.batch == noBatch) {
+      continue;
+    }
+    auto it = sendBatches.find(sqe.batch);
+    it->second.queued--;
+    it->second.remaining++;
+    it->second.submittedBytes += sqe.bytes;
+    sendsWaiting--;
+    bytesWaiting -= sqe.bytes;
+    sendsInFlight++;
+    bytesInFlight += sqe.bytes;
+  }
+}
+
+void Uring::provide(uint16_t bid) {
+  // not bufRing->bufs, the flexible array sits 8 bytes off in C++
+  io_uring_buf* buf = (io_uring_buf*)bufRing + (bufTail & (bufCount - 1));
+  buf->addr = (uint64_t)(bufMem + bid * bufSlot);
+  buf->len = bufSlot;
+  buf->bid = bid;
+  bufTail++;
+}
+
+void Uring::publish() {
+  storeRelease(&bufRing->tail, bufTail);
+}
+
+std::string Uring::armRecv(bool queryAddr) {
+  if (recvArmed) {
+    return "";
+  }
+  recvMsg.msg_namelen = queryAddr ? sizeof(sockaddr_storage) : 0;
+
+  io_uring_sqe* s = sqe();
+  if (!s) {
+    return "io_uring submission queue is full";
+  }
+  s->opcode = IORING_OP_RECVMSG;
+  s->fd = sock;
+  s->addr = (uint64_t)&recvMsg;
+  s->len = 1;
+  s->ioprio = IORING_RECV_MULTISHOT;
+  s->flags = IOSQE_BUFFER_SELECT;
+  s->buf_group = 0;
+  s->user_data = recvTag;
+  recvArmed = true;
+  return submit();
+}
+
+std::string Uring::cancelRecv() {
+  if (!recvArmed) {
+    return "";
+  }
+  io_uring_sqe* s = sqe();
+  if (!s) {
+    return "io_uring submission queue is full";
+  }
+  s->opcode = IORING_OP_ASYNC_CANCEL;
+  s->addr = recvTag;
+  s->user_data = cancelTag;
+  // the final recv completion clears recvArmed
+  return submit();
+}
+
+std::string Uring::send(Packets& packets) {
+  size_t n = packets.packets.size();
+  if (n == 0) {
+    return "";
+  }
+
+  uint64_t batch = nextBatch++;
+  auto& entry = sendBatches[batch];
+  entry.packets = packets.detach();
+  sendsWaiting += n;
+  for (auto& msg : entry.packets->packets) {
+    bytesWaiting += msg.msg_hdr.msg_iov->iov_len;
+  }
+  waiting.push_back(batch);
+  return pump();
+}
+
+// gives the waiting packets SQEs while the ring has room, oldest first
+std::string Uring::pump() {
+  while (!waiting.empty()) {
+    uint64_t batch = waiting.front();
+    auto& entry = sendBatches[batch];
+    auto& msgs = entry.packets->packets;
+
+    unsigned room = sqEntries - (sqLocalTail - loadAcquire(sqHead));
+    if (room == 0) {
+      auto err = submit();
+      if (err.size() > 0) {
+        return err;
+      }
+      room = sqEntries - (sqLocalTail - loadAcquire(sqHead));
+      if (room == 0) {
+        return "";
+      }
+    }
+
+    for (; room > 0 && entry.next < msgs.size(); --room, ++entry.next) {
+      auto& hdr = msgs[entry.next].msg_hdr;
+      io_uring_sqe* s = sqe(batch, hdr.msg_iov->iov_len);
+      s->opcode = IORING_OP_SENDMSG;
+      s->fd = sock;
+      s->addr = (uint64_t)&hdr;
+      s->len = 1;
+      s->msg_flags = entry.packets->flags;
+      s->user_data = (batch << 2) | sendTag;
+      entry.queued++;
+    }
+    if (entry.next == msgs.size()) {
+      waiting.pop_front();
+    }
+  }
+  return submit();
+}
+
+void Uring::finish(std::map<uint64_t, UringSendBatch>::iterator it) {
+  auto& entry = it->second;
+  if (entry.remaining > 0) {
+    return;
+  }
+  bytesInFlight -= entry.submittedBytes;
+  entry.submittedBytes = 0;
+  if (entry.queued == 0 && entry.next == entry.packets->packets.size()) {
+    // releases the JS buffers of the batch
+    sendBatches.erase(it);
+  }
+}
+
+void Uring::onRecv(const io_uring_cqe& cqe) {
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    // the multishot request is over: cancelled, out of buffers or failed
+    recvArmed = false;
+  }
+
+  if (cqe.res < 0) {
+    if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+      events.recvErr = std::strerror(-cqe.res);
+    }
+    return;
+  }
+  if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+    return;
+  }
+
+  uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  used.push_back(bid);
+
+  uint8_t* buf = bufMem + bid * bufSlot;
+  auto* out = (io_uring_recvmsg_out*)buf;
+  uint8_t* name = buf + sizeof(io_uring_recvmsg_out);
+  uint8_t* control = name + recvMsg.msg_namelen;
+  uint8_t* payload = control + recvMsg.msg_controllen;
+  size_t room = bufSlot - (payload - buf);
+
+  UringDatagram d;
+  d.slice.data = payload;
+  // a truncated datagram reports its full length
+  d.slice.len = std::min<size_t>(out->payloadlen, room);
+  if (recvMsg.msg_namelen > 0 && out->namelen > 0) {
+    d.addr = (const sockaddr*)name;
+  }
+
+#ifdef UDP_GRO
+  if (out->controllen > 0) {
+    msghdr hdr{};
+    hdr.msg_control = control;
+    hdr.msg_controllen = out->controllen;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(&hdr, cm)) {
+      if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+        int segment;
+        std::memcpy(&segment, CMSG_DATA(cm), sizeof(segment));
+        d.slice.segment = segment;
+      }
+    }
+  }
+#endif
+
+  events.datagrams.push_back(d);
+}
+
+void Uring::onSend(const io_uring_cqe& cqe) {
+  sendsInFlight--;
+  events.sent++;
+  if (cqe.res < 0) {
+    events.sendErrors++;
+    events.sendErr = std::strerror(-cqe.res);
+  }
+
+  auto it = sendBatches.find(cqe.user_data >> 2);
+  if (it != sendBatches.end()) {
+    it->second.remaining--;
+    finish(it);
+  }
+}
+
+UringEvents& Uring::reap() {
+  events = UringEvents{};
+
+  // the counter is cleared first, a completion after this wakes us up again
+  uint64_t count;
+  while (read(eventFd, &count, sizeof(count)) < 0 && errno == EINTR) {}
+
+  unsigned head = *cqHead;
+  unsigned tail = loadAcquire(cqTail);
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = cqes[head & cqMask];
+    switch (cqe.user_data & tagMask) {
+      case recvTag:
+        onRecv(cqe);
+        break;
+      case sendTag:
+        onSend(cqe);
+        break;
+      default:
+        break;
+    }
+  }
+  storeRelease(cqHead, head);
+
+  // the completions made room for what's waiting
+  if (!waiting.empty() || toSubmit > 0) {
+    auto err = pump();
+    if (err.size() > 0) {
+      events.sendErr = err;
+    }
+  }
+  return events;
+}
+
+void Uring::recycle() {
+  if (used.empty()) {
+    return;
+  }
+  for (auto bid : used) {
+    provide(bid);
+  }
+  used.clear();
+  publish();
+}
+
+void Uring::close() {
+  if (ringFd >= 0) {
+    ::close(ringFd);
+    ringFd = -1;
+  }
+  if (eventFd >= 0) {
+    ::close(eventFd);
+    eventFd = -1;
+  }
+  recvArmed = false;
+}
+
+#else
+
+static const char* unsupported = "io_uring is only available on Linux";
+
+Uring::~Uring() {}
+std::string Uring::open(SOCKET, size_t, unsigned, bool) { return unsupported; }
+std::string Uring::armRecv(bool) { return unsupported; }
+std::string Uring::cancelRecv() { return unsupported; }
+std::string Uring::send(Packets&) { return unsupported; }
+UringEvents& Uring::reap() { return events; }
+void Uring::recycle() {}
+void Uring::close() {}
+
+#endif
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <deque>
+#include <map>
+
+#include "common.hpp"
+#include "Sys.hpp"
+#include "Packets.hpp"
+#include "RecvPool.hpp"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+/* Linux-only socket backend on io_uring, the syscalls are made directly,
+ * there is no liburing dependency. Receiving is one multishot recvmsg
+ * that takes its buffers from a provided buffer ring, sending is one
+ * sendmsg SQE per packet, submitted with a single io_uring_enter per
+ * write(). Packets that don't fit in the submission queue, or that the
+ * kernel didn't take, wait in order and go out as completions free room,
+ * nothing is dropped. Completions are signalled on an eventfd, which the socket polls
+ * with libuv instead of the socket itself, and are reaped in bulk on the
+ * JS thread.
+ *
+ * Needs a 6.0+ kernel (multishot recvmsg), open() reports what's missing.
+ * Everything in here reports errors as strings.
+ */
+
+namespace OverTheWire::Transports::Socket {
+
+  const unsigned defaultUringEntries = 256;
+  const unsigned defaultUringBuffers = 64;
+
+  struct UringDatagram {
+    RecvSlice slice;
+    const sockaddr* addr = nullptr;
+  };
+
+  // what one reap() found, the datagrams point into the buffer ring until recycle()
+  struct UringEvents {
+    std::vector<UringDatagram> datagrams;
+    size_t sent = 0;
+    size_t sendErrors = 0;
+    std::string sendErr;
+    std::string recvErr;
+  };
+
+  struct UringSendBatch {
+    std::unique_ptr<Packets> packets;
+    // packets before it have an SQE
+    size_t next = 0;
+    // SQEs in the ring the kernel hasn't taken yet
+    size_t queued = 0;
+    // taken by the kernel and not completed
+    size_t remaining = 0;
+    size_t submittedBytes = 0;
+  };
+
+  struct Uring {
+    ~Uring();
+
+    std::string open(SOCKET, size_t bufSize, unsigned buffers, bool gro);
+    std::string armRecv(bool queryAddr);
+    std::string cancelRecv();
+    std::string send(Packets&);
+    UringEvents& reap();
+    void recycle();
+    void close();
+
+    size_t pendingSends() const { return sendsInFlight + sendsWaiting; }
+    size_t pendingBytes() const { return bytesInFlight + bytesWaiting; }
+
+#ifdef __linux__
+    static const uint64_t noBatch = ~uint64_t{0};
+    io_uring_sqe* sqe(uint64_t batch = noBatch, size_t bytes = 0);
+    std::string submit();
+    void submitted(unsigned);
+    std::string pump();
+    void finish(std::map<uint64_t, UringSendBatch>::iterator);
+    void provide(uint16_t);
+    void publish();
+    void onRecv(const io_uring_cqe&);
+    void onSend(const io_uring_cqe&);
+
+    int ringFd = -1;
+    int eventFd = -1;
+    SOCKET sock = -1;
+
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned sqLocalTail = 0;
+    unsigned toSubmit = 0;
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cqMask = 0;
+
+    io_uring_buf_ring* bufRing = nullptr;
+    size_t bufRingSize = 0;
+    uint8_t* bufMem = nullptr;
+    size_t bufMemSize = 0;
+    size_t bufSlot = 0;
+    unsigned bufCount = 0;
+    uint16_t bufTail = 0;
+
+    // the multishot recvmsg reads only the lengths from it
+    msghdr recvMsg{};
+    bool recvArmed = false;
+    std::vector<uint16_t> used;
+
+    // the SQEs in the ring the kernel hasn't taken yet, in ring order
+    struct PreparedSqe {
+      uint64_t batch;
+      size_t bytes;
+    };
+    std::deque<PreparedSqe> prepared;
+
+    uint64_t nextBatch = 0;
+    std::map<uint64_t, UringSendBatch> sendBatches;
+    // batches with packets that have no SQE yet, oldest first
+    std::deque<uint64_t> waiting;
+#endif
+    // taken by the kernel
+    size_t sendsInFlight = 0;
+    size_t bytesInFlight = 0;
+    // waiting for room in the ring or for the kernel to take them
+    size_t sendsWaiting = 0;
+    size_t bytesWaiting = 0;
+    UringEvents events;
+  };
+}
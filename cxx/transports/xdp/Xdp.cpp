@@ -0,0 +1,363 @@
+#include "Xdp.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <linux/if_xdp.h>
+#include "error/Error.hpp"
+#endif
+
+namespace OverTheWire::Transports::Xdp {
+
+#ifdef __linux__
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+bool XskRing::needsWakeup() {
+  return flags && (__atomic_load_n(flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP);
+}
+
+static std::string mapRing(SOCKET fd, XskRing& ring, const xdp_ring_offset& off, uint32_t size, size_t descSize, off_t pgoff) {
+  ring.mapSize = off.desc + size * descSize;
+  ring.map = ::mmap(nullptr, ring.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+  if (ring.map == MAP_FAILED) {
+    ring.map = nullptr;
+    return getSystemError();
+  }
+
+  auto* base = static_cast<uint8_t*>(ring.map);
+  ring.producer = reinterpret_cast<uint32_t*>(base + off.producer);
+  ring.consumer = reinterpret_cast<uint32_t*>(base + off.consumer);
+  ring.flags = reinterpret_cast<uint32_t*>(base + off.flags);
+  ring.descs = base + off.desc;
+  ring.mask = size - 1;
+  return "";
+}
+
+static void unmapRing(XskRing& ring) {
+  if (ring.map) {
+    ::munmap(ring.map, ring.mapSize);
+    ring = XskRing{};
+  }
+}
+
+XdpSocket::~XdpSocket() {
+  close();
+}
+
+std::string XdpSocket::open(const std::string& iface, const XdpConfig& cfg) {
+  config = cfg;
+
+  if ((config.ringSize & (config.ringSize - 1)) != 0 || (config.frameSize & (config.frameSize - 1)) != 0) {
+    return "Ring size and frame size must be powers of two";
+  }
+
+  ifindex = if_nametoindex(iface.c_str());
+  if (ifindex == 0) {
+    return "Could not find device";
+  }
+
+  fd = ::socket(AF_XDP, SOCK_RAW, 0);
+  if (fd < 0) {
+    return getSystemError();
+  }
+
+  std::string err;
+  if ((err = setupUmem()).size() > 0 || (err = setupRings()).size() > 0) {
+    return err;
+  }
+
+  sockaddr_xdp addr{};
+  addr.sxdp_family = AF_XDP;
+  addr.sxdp_ifindex = ifindex;
+  addr.sxdp_queue_id = config.queueId;
+  addr.sxdp_flags = (config.zeroCopy ? XDP_ZEROCOPY : XDP_COPY) | XDP_USE_NEED_WAKEUP;
+  if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    return getSystemError();
+  }
+
+  return program.attach(ifindex, config.queueId, fd, config.zeroCopy);
+}
+
+std::string XdpSocket::setupUmem() {
+  // half of the frames for receiving, half for sending
+  umemSize = size_t{config.frameSize} * config.ringSize * 2;
+  void* mem = ::mmap(nullptr, umemSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (mem == MAP_FAILED) {
+    umemSize = 0;
+    return getSystemError();
+  }
+  umem = static_cast<uint8_t*>(mem);
+
+  xdp_umem_reg reg{};
+  reg.addr = reinterpret_cast<uintptr_t>(umem);
+  reg.len = umemSize;
+  reg.chunk_size = config.frameSize;
+  reg.headroom = 0;
+  if (::setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0) {
+    return getSystemError();
+  }
+
+  txFree.clear();
+  txFree.reserve(config.ringSize);
+  for (uint64_t i = config.ringSize; i < config.ringSize * 2; ++i) {
+    txFree.push_back(i * config.frameSize);
+  }
+
+  return "";
+}
+
+std::string XdpSocket::setupRings() {
+  uint32_t size = config.ringSize;
+  for (int opt : { XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING, XDP_TX_RING }) {
+    if (::setsockopt(fd, SOL_XDP, opt, &size, sizeof(size)) < 0) {
+      return getSystemError();
+    }
+  }
+
+  xdp_mmap_offsets off{};
+  socklen_t len = sizeof(off);
+  if (::getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len) < 0) {
+    return getSystemError();
+  }
+
+  std::string err;
+  if ((err = mapRing(fd, fill, off.fr, size, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING)).size() > 0 ||
+      (err = mapRing(fd, completion, off.cr, size, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING)).size() > 0 ||
+      (err = mapRing(fd, rx, off.rx, size, sizeof(xdp_desc), XDP_PGOFF_RX_RING)).size() > 0 ||
+      (err = mapRing(fd, tx, off.tx, size, sizeof(xdp_desc), XDP_PGOFF_TX_RING)).size() > 0) {
+    return err;
+  }
+
+  // the fill ring is as large as the receive half of the UMEM, so every
+  // frame can sit in it and handing frames back never has to wait
+  for (uint32_t i{}; i < size; ++i) {
+    fill.at<uint64_t>(i) = uint64_t{i} * config.frameSize;
+  }
+  __atomic_store_n(fill.producer, size, __ATOMIC_RELEASE);
+
+  return "";
+}
+
+std::string XdpSocket::attachFilter(const bpf_program& prog) {
+  // the kernel doesn't run socket filters for AF_XDP, so the capture thread does
+  auto insns = std::make_shared<std::vector<bpf_insn>>(prog.bf_insns, prog.bf_insns + prog.bf_len);
+  std::atomic_store(&filter, insns);
+  return "";
+}
+
+bool XdpSocket::start(on_batch_t batchCb, on_packet_t packetCb) {
+  if (fd < 0 || running) {
+    return false;
+  }
+  onBatch = batchCb;
+  onPacket = packetCb;
+  running = true;
+  thread = std::thread{&XdpSocket::receiveMain, this};
+  return true;
+}
+
+void XdpSocket::stop() {
+  running = false;
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+bool XdpSocket::active() {
+  return running;
+}
+
+void XdpSocket::receiveMain() {
+  DEBUG_OUTPUT("XdpSocket::receiveMain");
+  pollfd pfd{};
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  uint64_t frameMask = ~uint64_t{config.frameSize - 1};
+
+  while (running) {
+    uint32_t cons = *rx.consumer;
+    uint32_t avail = __atomic_load_n(rx.producer, __ATOMIC_ACQUIRE) - cons;
+    uint32_t n = std::min(avail, config.rxBurst);
+
+    if (n == 0) {
+      if (fill.needsWakeup()) {
+        ::recvfrom(fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+      }
+      ::poll(&pfd, 1, 100);
+      continue;
+    }
+
+    // AF_XDP descriptors carry no timestamp, the whole burst gets the same one
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    auto flt = std::atomic_load(&filter);
+
+    std::unique_ptr<PacketBatch> batch;
+    if (onBatch) {
+      size_t bytes = 0;
+      for (uint32_t i{}; i < n; ++i) {
+        bytes += rx.at<xdp_desc>(cons + i).len;
+      }
+      batch = std::make_unique<PacketBatch>(bytes);
+      batch->meta.reserve(n * PacketBatch::fields);
+    }
+
+    uint32_t fillProd = *fill.producer;
+    uint32_t delivered = 0;
+    for (uint32_t i{}; i < n; ++i) {
+      auto& desc = rx.at<xdp_desc>(cons + i);
+      const uint8_t* data = umem + desc.addr;
+
+      if (flt && bpf_filter(flt->data(), data, desc.len, desc.len) == 0) {
+        rxFiltered.fetch_add(1, std::memory_order_relaxed);
+      }
+      else if (batch) {
+        batch->add(data, desc.len, desc.len, ts);
+        ++delivered;
+      }
+      else {
+        onPacket(data, desc.len, desc.len, ts);
+        ++delivered;
+      }
+
+      fill.at<uint64_t>(fillProd + i) = desc.addr & frameMask;
+    }
+
+    __atomic_store_n(rx.consumer, cons + n, __ATOMIC_RELEASE);
+    __atomic_store_n(fill.producer, fillProd + n, __ATOMIC_RELEASE);
+    rxPackets.fetch_add(delivered, std::memory_order_relaxed);
+
+    if (batch && batch->size() > 0) {
+      onBatch(batch.release());
+    }
+  }
+}
+
+uint32_t XdpSocket::reclaimCompleted() {
+  uint32_t cons = *completion.consumer;
+  uint32_t prod = __atomic_load_n(completion.producer, __ATOMIC_ACQUIRE);
+  for (uint32_t i = cons; i != prod; ++i) {
+    txFree.push_back(completion.at<uint64_t>(i));
+  }
+  __atomic_store_n(completion.consumer, prod, __ATOMIC_RELEASE);
+  return prod - cons;
+}
+
+void XdpSocket::kickTx() {
+  // in copy mode the kernel only transmits from inside the syscall
+  if (!config.zeroCopy || tx.needsWakeup()) {
+    ::sendto(fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+  }
+}
+
+int XdpSocket::send(const pcpp::RawPacket* packets, int n) {
+  std::lock_guard<std::mutex> lock{txMutex};
+  if (fd < 0) {
+    return 0;
+  }
+
+  int sent = 0;
+  int stalls = 0;
+  uint32_t prod = *tx.producer;
+  reclaimCompleted();
+
+  while (sent < n) {
+    if (txFree.empty()) {
+      __atomic_store_n(tx.producer, prod, __ATOMIC_RELEASE);
+      kickTx();
+      if (reclaimCompleted() == 0) {
+        if (++stalls > 100) {
+          break;
+        }
+        pollfd pfd{ fd, POLLOUT, 0 };
+        ::poll(&pfd, 1, 1);
+      }
+      continue;
+    }
+
+    auto len = packets[sent].getRawDataLen();
+    if (len <= 0 || static_cast<uint32_t>(len) > config.frameSize) {
+      break;
+    }
+
+    uint64_t addr = txFree.back();
+    txFree.pop_back();
+    std::memcpy(umem + addr, packets[sent].getRawData(), len);
+
+    auto& desc = tx.at<xdp_desc>(prod++);
+    desc.addr = addr;
+    desc.len = len;
+    desc.options = 0;
+    ++sent;
+  }
+
+  __atomic_store_n(tx.producer, prod, __ATOMIC_RELEASE);
+  kickTx();
+  txPackets.fetch_add(sent, std::memory_order_relaxed);
+  return sent;
+}
+
+XdpStats XdpSocket::stats() {
+  XdpStats res;
+  res.rxPackets = rxPackets.load(std::memory_order_relaxed);
+  res.rxFiltered = rxFiltered.load(std::memory_order_relaxed);
+  res.txPackets = txPackets.load(std::memory_order_relaxed);
+
+  xdp_statistics st{};
+  socklen_t len = sizeof(st);
+  if (fd >= 0 && ::getsockopt(fd, SOL_XDP, XDP_STATISTICS, &st, &len) == 0) {
+    res.rxDropped = st.rx_dropped;
+    res.rxInvalid = st.rx_invalid_descs;
+    res.rxRingFull = st.rx_ring_full;
+    res.fillRingEmpty = st.rx_fill_ring_empty_descs;
+    res.txInvalid = st.tx_invalid_descs;
+  }
+  return res;
+}
+
+void XdpSocket::close() {
+  stop();
+  std::lock_guard<std::mutex> lock{txMutex};
+  // detach first, so the kernel stops redirecting into a socket that goes away
+  program.detach();
+  for (auto* ring : { &fill, &completion, &rx, &tx }) {
+    unmapRing(*ring);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  if (umem) {
+    ::munmap(umem, umemSize);
+    umem = nullptr;
+  }
+}
+
+#else
+
+static const char* unsupported = "AF_XDP backend is only available on Linux";
+
+bool XskRing::needsWakeup() { return false; }
+
+XdpSocket::~XdpSocket() {}
+std::string XdpSocket::open(const std::string&, const XdpConfig&) { return unsupported; }
+std::string XdpSocket::attachFilter(const bpf_program&) { return unsupported; }
+bool XdpSocket::start(on_batch_t, on_packet_t) { return false; }
+void XdpSocket::stop() {}
+bool XdpSocket::active() { return false; }
+int XdpSocket::send(const pcpp::RawPacket*, int) { return 0; }
+XdpStats XdpSocket::stats() { return {}; }
+void XdpSocket::close() {}
+std::string XdpSocket::setupUmem() { return unsupported; }
+std::string XdpSocket::setupRings() { return unsupported; }
+void XdpSocket::receiveMain() {}
+uint32_t XdpSocket::reclaimCompleted() { return 0; }
+void XdpSocket::kickTx() {}
+
+#endif
+
+}
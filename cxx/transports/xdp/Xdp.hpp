@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "common.hpp"
+#include "transports/pcap/PacketBatch.hpp"
+#include "RawPacket.h"
+#include "pcap.h"
+#include "XdpProgram.hpp"
+
+/* Linux-only AF_XDP transport. The socket owns a UMEM (one anonymous
+ * mapping split into equal frames), the four rings shared with the kernel
+ * and a tiny XDP program that redirects every frame of the bound queue
+ * into the socket. The first half of the frames is used for receiving and
+ * lives in the fill/rx rings, the second half is used for sending and
+ * travels through the tx/completion rings.
+ *
+ * Note that the redirect takes packets away from the kernel stack on that
+ * queue, so this is an exclusive capture, unlike pcap or tpacket.
+ */
+
+namespace OverTheWire::Transports::Xdp {
+  using Pcap::PacketBatch;
+
+  struct XdpConfig {
+    uint32_t queueId = 0;
+    uint32_t frameSize = 4096;
+    uint32_t ringSize = 2048;
+    uint32_t rxBurst = 64;
+    // zero-copy needs driver support, copy mode works with generic (SKB) XDP everywhere
+    bool zeroCopy = false;
+  };
+
+  struct XdpStats {
+    uint64_t rxPackets = 0;
+    uint64_t txPackets = 0;
+    uint64_t rxFiltered = 0;
+    uint64_t rxDropped = 0;
+    uint64_t rxInvalid = 0;
+    uint64_t rxRingFull = 0;
+    uint64_t fillRingEmpty = 0;
+    uint64_t txInvalid = 0;
+  };
+
+  /* One of the producer/consumer rings, the pointers point into the mapping.
+   */
+  struct XskRing {
+    uint32_t* producer = nullptr;
+    uint32_t* consumer = nullptr;
+    uint32_t* flags = nullptr;
+    void* descs = nullptr;
+    uint32_t mask = 0;
+    void* map = nullptr;
+    size_t mapSize = 0;
+
+    template<typename T>
+    T& at(uint32_t idx) {
+      return static_cast<T*>(descs)[idx & mask];
+    }
+
+    bool needsWakeup();
+  };
+
+  struct XdpSocket {
+    using on_batch_t = std::function<void(PacketBatch*)>;
+    using on_packet_t = std::function<void(const uint8_t*, uint32_t, uint32_t, const timespec&)>;
+    using filter_ptr_t = std::shared_ptr<std::vector<bpf_insn>>;
+
+    ~XdpSocket();
+
+    std::string open(const std::string&, const XdpConfig&);
+    std::string attachFilter(const bpf_program&);
+    bool start(on_batch_t, on_packet_t);
+    void stop();
+    bool active();
+    int send(const pcpp::RawPacket*, int);
+    XdpStats stats();
+    void close();
+
+    std::string setupUmem();
+    std::string setupRings();
+    void receiveMain();
+    uint32_t reclaimCompleted();
+    void kickTx();
+
+    SOCKET fd = -1;
+    int ifindex = 0;
+    XdpConfig config;
+    XdpProgram program;
+
+    uint8_t* umem = nullptr;
+    size_t umemSize = 0;
+    XskRing fill, completion, rx, tx;
+
+    std::vector<uint64_t> txFree;
+    std::mutex txMutex;
+
+    filter_ptr_t filter;
+    on_batch_t onBatch;
+    on_packet_t onPacket;
+    std::thread thread;
+    std::atomic<bool> running = false;
+    std::atomic<uint64_t> rxPackets = 0;
+    std::atomic<uint64_t> rxFiltered = 0;
+    std::atomic<uint64_t> txPackets = 0;
+  };
+}
@@ -0,0 +1,105 @@
+#include "XdpProgram.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include "error/Error.hpp"
+#endif
+
+namespace OverTheWire::Transports::Xdp {
+
+#ifdef __linux__
+
+static int bpf(int cmd, bpf_attr& attr) {
+  return ::syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+}
+
+static uint64_t ptr(const void* p) {
+  return reinterpret_cast<uintptr_t>(p);
+}
+
+XdpProgram::~XdpProgram() {
+  detach();
+}
+
+std::string XdpProgram::attach(int ifindex, uint32_t queueId, SOCKET xsk, bool driverMode) {
+  bpf_attr attr{};
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = queueId + 1;
+  std::strncpy(attr.map_name, "otw_xsks", sizeof(attr.map_name) - 1);
+  mapFd = bpf(BPF_MAP_CREATE, attr);
+  if (mapFd < 0) {
+    return "BPF_MAP_CREATE: " + getSystemError();
+  }
+
+  uint32_t value = xsk;
+  attr = {};
+  attr.map_fd = mapFd;
+  attr.key = ptr(&queueId);
+  attr.value = ptr(&value);
+  attr.flags = BPF_ANY;
+  if (bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+    return "BPF_MAP_UPDATE_ELEM: " + getSystemError();
+  }
+
+  /* r2 = ctx->rx_queue_index
+   * r1 = xsks map
+   * r3 = XDP_PASS, what happens to frames of queues without a socket
+   * return bpf_redirect_map(r1, r2, r3)
+   */
+  bpf_insn insns[] = {
+    { BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(xdp_md, rx_queue_index), 0 },
+    { BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, mapFd },
+    { 0, 0, 0, 0, 0 },
+    { BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS },
+    { BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map },
+    { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 },
+  };
+
+  attr = {};
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = ptr(insns);
+  attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+  attr.license = ptr("GPL");
+  std::strncpy(attr.prog_name, "otw_redirect", sizeof(attr.prog_name) - 1);
+  progFd = bpf(BPF_PROG_LOAD, attr);
+  if (progFd < 0) {
+    return "BPF_PROG_LOAD: " + getSystemError();
+  }
+
+  // a link detaches the program by itself once its fd is closed, even if we crash
+  attr = {};
+  attr.link_create.prog_fd = progFd;
+  attr.link_create.target_ifindex = ifindex;
+  attr.link_create.attach_type = BPF_XDP;
+  attr.link_create.flags = driverMode ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+  linkFd = bpf(BPF_LINK_CREATE, attr);
+  if (linkFd < 0) {
+    return "BPF_LINK_CREATE: " + getSystemError();
+  }
+
+  return "";
+}
+
+void XdpProgram::detach() {
+  for (int* fd : { &linkFd, &progFd, &mapFd }) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+#else
+
+XdpProgram::~XdpProgram() {}
+std::string XdpProgram::attach(int, uint32_t, SOCKET, bool) { return "AF_XDP backend is only available on Linux"; }
+void XdpProgram::detach() {}
+
+#endif
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.hpp"
+
+/* Loads the XDP program that redirects a queue into an AF_XDP socket.
+ * Kept apart from Xdp.hpp because linux/bpf.h and pcap.h both declare
+ * struct bpf_insn, and those can't live in one translation unit.
+ */
+
+namespace OverTheWire::Transports::Xdp {
+
+  struct XdpProgram {
+    ~XdpProgram();
+
+    std::string attach(int ifindex, uint32_t queueId, SOCKET xsk, bool driverMode);
+    void detach();
+
+    int mapFd = -1;
+    int progFd = -1;
+    int linkFd = -1;
+  };
+}
@@ -1,6 +1,17 @@
 const { BpfFilter: BpfFilterCxx } = require('#lib/bindings');
 const { Packet } = require('#lib/packet');
+const { PacketBatch } = require('#lib/packetBatch');
 
+/**
+ * A compiled BPF filter, made from an expression or from bytecode:
+ * `new BpfFilter(expr, linkType, snaplen)` or `new BpfFilter(bytecode, linkType)`.
+ * `bytecode` is the compiled program as a Buffer of bpf_insn, ready for
+ * Socket.attachFilter(), and can be set to run another program.
+ *
+ * Expressions are compiled once per process: filters, filter sets and
+ * device filters with the same expression, link type and snaplen share the
+ * program from a native cache, see the static methods below.
+ */
 class BpfFilter extends BpfFilterCxx {
   constructor(...args) {
     super(...args);
@@ -12,6 +23,56 @@ class BpfFilter extends BpfFilterCxx {
     }
     return super.match(pkt, ...args);
   }
+
+  /**
+   * Matches many packets in one native call.
+   * @param {PacketBatch|Array<Packet|Buffer>|Buffer} input - The packets, or one buffer holding all of them.
+   * @param {Uint32Array} [table] - With a buffer: `stride` values per packet, its offset and length first.
+   * @param {Object} [options]
+   * @param {boolean} [options.indices] - Return the indices of the matching packets instead of a bitmap.
+   * @param {number} [options.stride] - Table values per packet, 2 by default.
+   * @param {number} [options.wireLengthField] - Where the table holds the length on the wire, the captured length is used otherwise.
+   * @returns {Uint8Array|Uint32Array} A bitmap, packet i matched if `bitmap[i >> 3] & (1 << (i & 7))`, or the indices.
+   */
+  matchMany(input, ...args) {
+    if (input instanceof PacketBatch) {
+      // see the meta layout in lib/packetBatch.js
+      return super.matchMany(input.arena, input.meta, { stride: 5, wireLengthField: 2, ...args[0] });
+    }
+    if (Array.isArray(input)) {
+      return super.matchMany(input.map(pkt => pkt instanceof Packet ? pkt.buffer : pkt), ...args);
+    }
+    return super.matchMany(input, ...args);
+  }
+
+  /**
+   * Compiles expressions into the cache ahead of time.
+   * @name BpfFilter.warm
+   * @function
+   * @param {string[]} expressions
+   * @param {number} [linkType] - Ethernet by default.
+   * @param {number} [snaplen] - 65535 by default.
+   * @throws On the first expression that doesn't compile.
+   */
+
+  /**
+   * @name BpfFilter.cacheStats
+   * @function
+   * @returns {{hits: number, misses: number, size: number, capacity: number}}
+   */
+
+  /**
+   * Sets how many programs the cache keeps, the least recently used ones go first. 1024 by default.
+   * @name BpfFilter.setCacheCapacity
+   * @function
+   * @param {number} capacity
+   */
+
+  /**
+   * Drops the cached programs and resets the counters. Filters keep the programs they use.
+   * @name BpfFilter.clearCache
+   * @function
+   */
 }
 
 module.exports = { BpfFilter };
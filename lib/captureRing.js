@@ -0,0 +1,202 @@
+const { TimeStamp } = require('#lib/timestamp');
+
+// Layout shared with cxx/transports/pcap/CaptureRing.hpp, indexes are in 32-bit words
+const MAGIC = 0;
+const CAPACITY = 2;
+const DROPPED = 3;
+const WAITING = 4;
+const SEQ = 5;
+const HEAD = 16;
+const TAIL = 32;
+const DATA = 192;
+
+const RING_MAGIC = 0x5257544f;
+const RECORD_HEADER = 16;
+const WRAP_MARKER = 0xffffffff;
+
+const align8 = v => (v + 7) & ~7;
+
+/**
+ * @typedef {Object} RingRecord
+ * @property {Buffer} buffer - The captured frame, points directly into the ring memory.
+ * @property {number} origLength - The length of the frame on the wire.
+ * @property {TimeStamp} timestamp - The capture time.
+ */
+
+/**
+ * Consumer side of the capture ring filled by a LiveDevice in ring mode.
+ * The memory can be a SharedArrayBuffer, so the ring can be handed to a worker thread
+ * and read there with CaptureRing.from(buffer).
+ * Records returned by next() stay valid until release() is called.
+ */
+class CaptureRing {
+  /**
+   * Allocates memory for a new ring.
+   * @param {Object} [options]
+   * @param {number} [options.size] - Size of the ring in bytes, including the header.
+   * @param {boolean} [options.shared] - Use a SharedArrayBuffer.
+   * @returns {CaptureRing}
+   */
+  static create({ size = 32 << 20, shared = true } = {}) {
+    return new CaptureRing(shared ? new SharedArrayBuffer(size) : new ArrayBuffer(size));
+  }
+
+  /**
+   * Attaches to the memory of an already initialized ring, e.g. inside of a worker thread.
+   * @param {SharedArrayBuffer|ArrayBuffer} buffer
+   * @returns {CaptureRing}
+   */
+  static from(buffer) {
+    const ring = new CaptureRing(buffer);
+    if (ring.u32[MAGIC] !== RING_MAGIC) {
+      throw new Error('Memory does not contain an initialized capture ring');
+    }
+    return ring;
+  }
+
+  constructor(buffer) {
+    this.memory = buffer;
+    this.shared = typeof SharedArrayBuffer != 'undefined' && buffer instanceof SharedArrayBuffer;
+    this.i32 = new Int32Array(buffer, 0, DATA / 4);
+    this.u32 = new Uint32Array(buffer, 0, DATA / 4);
+    this._pos = null;
+    this._waiters = [];
+  }
+
+  /**
+   * The view handed to the native side.
+   * @type {Uint8Array}
+   */
+  get view() {
+    return new Uint8Array(this.memory);
+  }
+
+  /**
+   * Usable data capacity in bytes.
+   * @type {number}
+   */
+  get capacity() {
+    return this.u32[CAPACITY];
+  }
+
+  /**
+   * Number of packets dropped because the ring was full.
+   * @type {number}
+   */
+  get dropped() {
+    return Atomics.load(this.u32, DROPPED);
+  }
+
+  _init() {
+    if (this._pos === null) {
+      this._data = Buffer.from(this.memory, DATA, this.capacity);
+      this._words = new Uint32Array(this.memory, DATA, this.capacity / 4);
+      this._pos = Atomics.load(this.u32, TAIL);
+    }
+  }
+
+  /**
+   * Whether there are records that were not returned by next() yet.
+   * @returns {boolean}
+   */
+  pending() {
+    this._init();
+    return Atomics.load(this.u32, HEAD) !== this._pos;
+  }
+
+  /**
+   * Returns the next record without releasing it, or null if the ring is empty.
+   * @returns {RingRecord|null}
+   */
+  next() {
+    this._init();
+    const head = Atomics.load(this.u32, HEAD);
+    const mask = this.capacity - 1;
+
+    while (this._pos !== head) {
+      const at = this._pos & mask;
+      const len = this._words[at / 4];
+
+      if (len === WRAP_MARKER) {
+        this._pos = (this._pos + this.capacity - at) >>> 0;
+        continue;
+      }
+
+      const record = {
+        buffer: this._data.subarray(at + RECORD_HEADER, at + RECORD_HEADER + len),
+        origLength: this._words[at / 4 + 1],
+        timestamp: new TimeStamp({ s: this._words[at / 4 + 2], ns: this._words[at / 4 + 3] }),
+      };
+
+      this._pos = (this._pos + align8(RECORD_HEADER + len)) >>> 0;
+      return record;
+    }
+
+    return null;
+  }
+
+  /**
+   * Gives the space of every record returned by next() back to the producer.
+   */
+  release() {
+    if (this._pos !== null) {
+      Atomics.store(this.u32, TAIL, this._pos);
+    }
+  }
+
+  /**
+   * Calls fn for up to max records and releases them afterwards.
+   * @param {function(RingRecord)} fn
+   * @param {number} [max]
+   * @returns {number} The number of records read.
+   */
+  read(fn, max = Infinity) {
+    let n = 0;
+    let record;
+    while (n < max && (record = this.next()) !== null) {
+      fn(record);
+      n++;
+    }
+    this.release();
+    return n;
+  }
+
+  /**
+   * Resolves once the producer has written something new.
+   * @returns {Promise<void>}
+   */
+  async wait() {
+    const seq = Atomics.load(this.i32, SEQ);
+    Atomics.store(this.i32, WAITING, 1);
+
+    if (this.pending()) {
+      Atomics.store(this.i32, WAITING, 0);
+      return;
+    }
+
+    if (this.shared && typeof Atomics.waitAsync == 'function') {
+      const { async, value } = Atomics.waitAsync(this.i32, SEQ, seq);
+      if (async) {
+        await value;
+      }
+      return;
+    }
+
+    await new Promise(resolve => this._waiters.push(resolve));
+  }
+
+  /**
+   * Wakes up consumers blocked in wait(). Called by the LiveDevice when the native side asks for it.
+   */
+  notify() {
+    Atomics.add(this.i32, SEQ, 1);
+    if (this.shared) {
+      Atomics.notify(this.i32, SEQ);
+    }
+    const waiters = this._waiters;
+    this._waiters = [];
+    waiters.forEach(resolve => resolve());
+  }
+}
+
+module.exports = { CaptureRing };
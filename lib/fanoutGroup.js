@@ -0,0 +1,112 @@
+const os = require('node:os');
+const { LiveDevice } = require('#lib/liveDevice');
+
+const fanoutModes = ['hash', 'lb', 'roundrobin', 'cpu', 'rollover', 'random', 'qm'];
+
+let nextId = (process.pid * 31) & 0xffff;
+const allocateId = () => {
+  nextId = (nextId + 1) & 0xffff;
+  return nextId;
+};
+
+/**
+ * @typedef {Object} FanoutGroupOptions
+ * @property {string} iface - The network interface name.
+ * @property {number} [shards] - Number of capture handles, defaults to the number of CPUs.
+ * @property {string} [mode] - How the kernel spreads packets: "hash" (per flow, default), "lb"/"roundrobin", "cpu", "rollover", "random" or "qm" (per rx queue).
+ * @property {number} [id] - The fanout group id, unique per network namespace. Picked automatically if omitted.
+ * @property {boolean} [defrag] - Reassemble IP fragments before hashing, so they land on the same shard (hash mode).
+ * All the other LiveDeviceOptions are applied to every shard. Passing a CaptureRing instance as ring is not supported, pass ring options instead, so every shard gets its own ring.
+ */
+
+/**
+ * A set of LiveDevice streams on the same interface that joined one PACKET_FANOUT group.
+ * The kernel splits the traffic between them and each shard runs its own capture thread
+ * (tpacket backend), so processing can scale across cores.
+ * Each shard is a regular LiveDevice, consume them separately or hand the ring memory
+ * of each shard (device.ring.memory) to its own worker thread.
+ */
+class FanoutGroup {
+  /**
+   * Creates the shards, they are opened like any other LiveDevice.
+   * @param {FanoutGroupOptions} options
+   */
+  constructor({ shards = os.availableParallelism?.() ?? os.cpus().length, mode = 'hash', id, defrag = true, ...options } = {}) {
+    if (!fanoutModes.includes(mode)) {
+      throw new Error(`Unknown fanout mode ${mode}`);
+    }
+    if (id !== undefined && typeof id !== 'number') {
+      throw new TypeError('Fanout id must be a number');
+    }
+    if (id !== undefined && !(Number.isInteger(id) && id >= 0 && id <= 0xffff)) {
+      throw new RangeError('Fanout id must be an integer between 0 and 65535');
+    }
+
+    this.id = id ?? allocateId();
+    this.mode = mode;
+
+    /**
+     * @type {LiveDevice[]}
+     */
+    this.devices = Array.from({ length: shards }, () => new LiveDevice({
+      ...options,
+      backend: 'tpacket',
+      fanout: { id: this.id, mode, defrag },
+    }));
+  }
+
+  /**
+   * Number of shards.
+   * @type {number}
+   */
+  get size() {
+    return this.devices.length;
+  }
+
+  /**
+   * Statistics of every shard, in shard order.
+   * @type {DeviceStats[]}
+   */
+  get stats() {
+    return this.devices.map(dev => dev.stats);
+  }
+
+  /**
+   * Sum of the statistics of all shards.
+   * @type {DeviceStats}
+   */
+  get totalStats() {
+    return this.stats.reduce((res, stats) => {
+      for (const [key, value] of Object.entries(stats)) {
+        res[key] = (res[key] ?? 0) + value;
+      }
+      return res;
+    }, {});
+  }
+
+  /**
+   * The filter applied to every shard.
+   * @type {string}
+   */
+  set filter(filter) {
+    this.devices.forEach(dev => dev.filter = filter);
+  }
+
+  get filter() {
+    return this.devices[0]?.filter;
+  }
+
+  /**
+   * Destroys every shard.
+   * @param {Error} [err]
+   */
+  destroy(err) {
+    this.devices.forEach(dev => dev.destroy(err));
+  }
+
+  [Symbol.iterator]() {
+    return this.devices[Symbol.iterator]();
+  }
+}
+
+module.exports = { FanoutGroup, fanoutModes };
@@ -0,0 +1,74 @@
+const { FilterSet: FilterSetCxx } = require('#lib/bindings');
+const { Packet } = require('#lib/packet');
+const { PacketBatch } = require('#lib/packetBatch');
+
+/**
+ * Many named BPF filters evaluated together. Each packet gets a bitmask of
+ * the filters it matched, bit i of word i >> 5 being the i-th label.
+ * The leading checks the compiled programs have in common (the ethertype,
+ * the IP protocol...) are evaluated once per packet, identical programs run once.
+ */
+class FilterSet extends FilterSetCxx {
+  /**
+   * @param {Object<string, string>|Map<string, string>|string[]} filters - Expressions by label, or expressions that are their own labels.
+   * @param {number} [linkType] - LINKTYPE_ETHERNET by default.
+   */
+  constructor(filters, ...args) {
+    const entries = Array.isArray(filters) ? filters.map(expr => [expr, expr])
+      : filters instanceof Map ? [...filters] : Object.entries(filters);
+    super(entries.map(([, expr]) => expr), ...args);
+
+    /**
+     * The labels, in bit order.
+     * @type {string[]}
+     */
+    this.labels = entries.map(([label]) => label);
+  }
+
+  /**
+   * @param {Packet|Buffer} pkt
+   * @returns {Uint32Array} The mask, `words` long.
+   */
+  match(pkt) {
+    return super.match(pkt instanceof Packet ? pkt.buffer : pkt);
+  }
+
+  /**
+   * Matches many packets in one native call, takes what BpfFilter.matchMany takes.
+   * @param {PacketBatch|Array<Packet|Buffer>|Buffer} input
+   * @param {...*} args
+   * @returns {Uint32Array} `words` values per packet.
+   */
+  matchMany(input, ...args) {
+    if (input instanceof PacketBatch) {
+      // see the meta layout in lib/packetBatch.js
+      return super.matchMany(input.arena, input.meta, { stride: 5, wireLengthField: 2, ...args[0] });
+    }
+    if (Array.isArray(input)) {
+      return super.matchMany(input.map(pkt => pkt instanceof Packet ? pkt.buffer : pkt), ...args);
+    }
+    return super.matchMany(input, ...args);
+  }
+
+  /**
+   * The labels a packet matched.
+   * @param {Uint32Array} masks - What match() or matchMany() returned.
+   * @param {number} [i] - The packet, for matchMany() results.
+   * @returns {string[]}
+   */
+  labelsOf(masks, i = 0) {
+    const res = [];
+    const base = i * this.words;
+    for (let w = 0; w < this.words; ++w) {
+      let word = masks[base + w];
+      while (word) {
+        const bit = 31 - Math.clz32(word & -word);
+        res.push(this.labels[w * 32 + bit]);
+        word &= word - 1;
+      }
+    }
+    return res;
+  }
+}
+
+module.exports = { FilterSet };
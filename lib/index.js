@@ -1,9 +1,14 @@
 const { LiveDevice } = require('./liveDevice');
 const socket = require('./socket');
 const { BpfFilter } = require('./bpfFilter');
+const { FilterSet } = require('./filterSet');
 const { LinkLayerType } = require('./enums');
 const { createReadStream, createWriteStream, constants } = require('./pcapFile');
 const { Packet } = require('./packet');
+const { PacketBatch } = require('./packetBatch');
+const { CaptureRing } = require('./captureRing');
+const { FanoutGroup } = require('./fanoutGroup');
+const { Replay } = require('./replay');
 const { getArpTable } = require('./arp');
 const { getRoutingTable } = require('./routing');
 const { gatewayFor } = require('./gateway');
@@ -12,6 +17,10 @@ const converters = require('./converters');
 module.exports = { 
   Pcap: {
     LiveDevice,
+    PacketBatch,
+    CaptureRing,
+    FanoutGroup,
+    Replay,
     createReadStream, 
     createWriteStream, 
     constants,
@@ -19,6 +28,7 @@ module.exports = {
   socket,
   LinkLayerType,
   BpfFilter,
+  FilterSet,
   Packet,
   system: {
     ...converters,
@@ -2,6 +2,8 @@ const { Duplex } = require('stream');
 const { PcapDevice: LiveDeviceCxx } = require('#lib/bindings');
 const { pick } = require('#lib/pick');
 const { Packet } = require('#lib/packet');
+const { PacketBatch } = require('#lib/packetBatch');
+const { CaptureRing } = require('#lib/captureRing');
 
 const optionsKeys = [
   'capture', 
@@ -12,12 +14,40 @@ const optionsKeys = [
   'packetBufferSize',
   'snapshotLength',
   'nflogGroup',
+  'batchSize',
+  'batchTimeoutUs',
+  'backend',
+  'tpacketBlockSize',
+  'tpacketBlockCount',
+  'tpacketRetireTimeoutMs',
+  'xdpQueue',
+  'xdpMode',
+  'xdpFrameSize',
+  'xdpRingSize',
+  'fanout',
+  'queueHighWatermark',
+  'queueLowWatermark',
+  'queueDropPolicy',
+  'txQueueSize',
+  'txBackend',
+  'txQdiscBypass',
+  'record',
 ];
 
 const manualOptionsKeys = ['filter', 'iface'];
 
 const getOptions = obj => pick(obj, ...optionsKeys, ...manualOptionsKeys);
 
+/**
+ * @typedef {Object} RecordOptions
+ * @property {string} path - The output file. With rotation enabled files are named <name>-00000<ext>, <name>-00001<ext> and so on.
+ * @property {string} [format] - Either "pcap" (default) or "pcapng".
+ * @property {number} [rotateBytes] - Start a new file once the current one would grow past this size.
+ * @property {number} [rotateSeconds] - Start a new file once the current one is this old (checked when a packet arrives).
+ * @property {number} [rotatePackets] - Start a new file after this many packets.
+ * @property {number} [bufferSize] - Size of the write buffer in bytes.
+ */
+
 /**
  * @typedef {Object} LiveDeviceOptions
  * @property {string} [mode] - The mode of the device, either "promiscuous" or "normal".
@@ -26,6 +56,25 @@ const getOptions = obj => pick(obj, ...optionsKeys, ...manualOptionsKeys);
  * @property {number} [packetBufferSize] - The size of the packet buffer.
  * @property {number} [snapshotLength] - The snapshot length for packet capture.
  * @property {number} [nflogGroup] - The NFLOG group.
+ * @property {number} [batchSize] - Deliver captured packets in batches of up to this many packets (PacketBatch chunks instead of Packet).
+ * @property {number} [batchTimeoutUs] - Flush an incomplete batch once its oldest packet is this old, in microseconds.
+ * @property {string} [backend] - The capture backend: "pcap" (default), "tpacket" (Linux TPACKET_V3 mmap ring, always delivers PacketBatch chunks, one per ring block) or "xdp" (Linux AF_XDP socket, always delivers PacketBatch chunks, one per receive burst).
+ * @property {number} [tpacketBlockSize] - Size of a tpacket ring block in bytes, a multiple of the page size.
+ * @property {number} [tpacketBlockCount] - Number of tpacket ring blocks.
+ * @property {number} [tpacketRetireTimeoutMs] - Hand a partially filled tpacket block over after this many milliseconds.
+ * @property {number} [xdpQueue] - The queue the AF_XDP socket is bound to. Frames of that queue no longer reach the kernel stack while the device is open.
+ * @property {string} [xdpMode] - Either "copy" (generic XDP, works on any interface including veth) or "zerocopy" (native XDP, needs driver support).
+ * @property {number} [xdpFrameSize] - Size of a UMEM frame in bytes, a power of two.
+ * @property {number} [xdpRingSize] - Number of descriptors in each AF_XDP ring, a power of two. The UMEM holds twice as many frames.
+ * @property {Object} [fanout] - Join a PACKET_FANOUT group (tpacket backend only): { id, mode, defrag }, see FanoutGroup.
+ * @property {number} [queueHighWatermark] - Packets waiting for the stream consumer before the native queue starts dropping.
+ * @property {number} [queueLowWatermark] - Once dropping, the queue keeps dropping until it is back under this many packets.
+ * @property {string} [queueDropPolicy] - What to drop when the queue is full, either "drop-newest" (default) or "drop-oldest".
+ * @property {string} [txBackend] - How the pcap backend sends: "pcap" (default, one syscall per frame) or "sendmmsg" (Linux, a whole write per syscall on a separate AF_PACKET socket). The tpacket backend always uses sendmmsg.
+ * @property {boolean} [txQdiscBypass] - Hand frames sent with txBackend "sendmmsg" straight to the driver, skipping the qdisc layer.
+ * @property {number} [txQueueSize] - Writes the transmit thread can have queued before new ones fail, rounded up to a power of two. Only used when the device is created.
+ * @property {RecordOptions} [record] - Write captured packets to files from the capture thread instead of pushing them to the stream. Emits 'rotated' with { path, index, packets, bytes } for every finished file.
+ * @property {boolean|Object|CaptureRing} [ring] - Write captured packets into a shared memory ring instead of the stream, either a CaptureRing or options for CaptureRing.create. Capture starts when the device is open, the stream doesn't have to be read.
  * @property {string} [iface] - The network interface name.
  * @property {string} [filter] - The filter string for packet capture.
  */
@@ -36,6 +85,26 @@ const getOptions = obj => pick(obj, ...optionsKeys, ...manualOptionsKeys);
  * @property {number} packetsDrop - The number of packets dropped.
  * @property {number} packetsDropByInterface - The number of packets dropped by the interface.
  * @property {number} packetsRecv - The number of packets received.
+ * @property {number} queueDropped - The number of packets dropped because the stream consumer was too slow and the native queue was full.
+ * @property {number} queueDepth - The number of packets waiting in the native queue.
+ * @property {number} txQueueDepth - The number of writes waiting for the transmit thread.
+ * @property {number} txPackets - The number of packets sent by the transmit thread.
+ * @property {number} txErrors - The number of writes that failed.
+ * @property {number} txLatencyAvgUs - The average time from a write call until its packets were sent, in microseconds.
+ * @property {number} txLatencyMaxUs - The longest time from a write call until its packets were sent, in microseconds.
+ * @property {number} [recordedPackets] - The number of packets written to files (record mode only).
+ * @property {number} [recordedBytes] - The number of bytes written to files (record mode only).
+ * @property {number} [recordedFiles] - The number of files opened (record mode only).
+ * @property {number} [recordErrors] - The number of failed writes (record mode only).
+ * @property {number} [ringDropped] - The number of packets dropped because the capture ring was full (ring mode only).
+ * @property {number} [ringDrops] - The number of packets the kernel dropped because every tpacket block was taken (tpacket backend only).
+ * @property {number} [ringFreezes] - The number of times the tpacket ring was frozen by the kernel (tpacket backend only).
+ * @property {number} [ringStalls] - The number of tpacket blocks that were still held by JS when capture got back to them, they were copied out of the ring (tpacket backend only).
+ * @property {number} [packetsFiltered] - The number of packets rejected by the filter (xdp backend only, filters run in user space there).
+ * @property {number} [packetsSent] - The number of packets handed to the AF_XDP tx ring (xdp backend only).
+ * @property {number} [ringFull] - The number of packets dropped because the AF_XDP rx ring was full (xdp backend only).
+ * @property {number} [fillRingEmpty] - The number of times the kernel found no free frame in the fill ring (xdp backend only).
+ * @property {number} [invalidDescs] - The number of invalid rx/tx descriptors (xdp backend only).
  */
 
 /**
@@ -52,6 +121,11 @@ const getOptions = obj => pick(obj, ...optionsKeys, ...manualOptionsKeys);
 
 /**
  * Duplex stream for capturing and injecting packets on a specific device.
+ * Emits Packet objects, or PacketBatch objects when batchSize is greater than 1 or the tpacket/xdp backend is used.
+ * In ring mode nothing is pushed to the stream, capture starts once the device is open,
+ * packets are read from the device.ring and the 'ring' event is emitted when a waiting
+ * consumer has to be woken up.
+ * In record mode nothing is pushed either, packets go straight to files and 'rotated' is emitted.
  * @extends Duplex
  */
 class LiveDevice extends Duplex {
@@ -79,32 +153,45 @@ class LiveDevice extends Duplex {
       });
     });
 
-    this.options.push = (buffer) => {
+    this.options.push = (buffer, meta) => {
       if (!this._ifaceCached) {
         this._ifaceCached = this.iface;
       }
 
-      const res = this.push(new Packet({ buffer, iface: this._iface }));
+      // false pauses the native queue until the next _read, the capture thread keeps running
+      return meta ? 
+        this.push(new PacketBatch({ buffer, meta, iface: this._iface })) : 
+        this.push(new Packet({ buffer, iface: this._iface }));
+    };
 
-      if (!res) {
-        this.pcapInternal.stopCapture();
-        this.capturing = false;
+    this.options.event = (name, data) => {
+      if (name == 'ring') {
+        this.ring?.notify();
+      }
+      if (name == 'recordError') {
+        return this.destroy(new Error(`Recording failed: ${data.message}`));
       }
+      this.emit(name, data);
     };
 
     this.pcapInternal = new LiveDeviceCxx(this.options);
-  }
 
-  _construct(callback) {
-    if (this.optionsChanged) {
-      this.pcapInternal.setConfig(this.options);
+    if (options.ring) {
+      const { ring } = options;
+      this.ring = ring instanceof CaptureRing ? ring : CaptureRing.create(ring === true ? {} : ring);
+      this.pcapInternal.attachRing(this.ring.view);
     }
+  }
 
+  _construct(callback) {
     if (!this.pcapInternal) {
       return callback();
     }
 
     try {
+      if (this.optionsChanged) {
+        this.pcapInternal.setConfig(this.options);
+      }
       this.pcapInternal.open();
     } catch (err) {
       return callback(err);
@@ -114,6 +201,10 @@ class LiveDevice extends Duplex {
     if (this.options.filter) {
       this.pcapInternal.setFilter(this.options.filter);
     }
+    if (this.options.record || this.options.ring) {
+      // nothing is pushed in record or ring mode, flowing just gets the capture going
+      this.resume();
+    }
     callback();
   }
 
@@ -123,6 +214,8 @@ class LiveDevice extends Duplex {
     } else if (!this.capturing) {
       this.pcapInternal.startCapture();
       this.capturing = true;
+    } else {
+      this.pcapInternal.resume();
     }
   }
 
@@ -145,6 +238,27 @@ class LiveDevice extends Duplex {
     return this.pcapInternal._write(chunks.map(e => e.chunk instanceof Packet ? e.chunk.buffer : e.chunk), callback);
   }
 
+  /**
+   * Sends the frames outside of the stream and reports how many of them
+   * the kernel accepted. The rest (frames.slice(accepted)) can be retried,
+   * a partial send does not error the stream.
+   * @param {Array<Packet|Buffer|TypedArray>} frames - The frames to send, in order.
+   * @returns {Promise<number>} The number of frames accepted.
+   */
+  inject(frames) {
+    if (!this.isOpen) {
+      return Promise.reject(new Error('Device is not open'));
+    }
+    const bufs = frames.map(e => e instanceof Packet ? e.buffer : e);
+    return new Promise((resolve, reject) => {
+      try {
+        this.pcapInternal._inject(bufs, (err, accepted) => err ? reject(err) : resolve(accepted));
+      } catch (err) {
+        reject(err);
+      }
+    });
+  }
+
   _destroy(err, callback) {
     if (this.pcapInternal) {
       this.pcapInternal._destroy();
@@ -0,0 +1,94 @@
+const { Packet } = require('#lib/packet');
+const { TimeStamp } = require('#lib/timestamp');
+
+// Layout of the meta table, see cxx/transports/pcap/PacketBatch.hpp
+const OFFSET = 0;
+const LENGTH = 1;
+const ORIG_LENGTH = 2;
+const TS_SEC = 3;
+const TS_NSEC = 4;
+const FIELDS = 5;
+
+/**
+ * A bunch of captured packets sharing one contiguous buffer.
+ * Packet objects are created only when they are accessed.
+ */
+class PacketBatch {
+  /**
+   * @param {Object} data
+   * @param {Buffer} data.buffer - The arena holding every packet of the batch.
+   * @param {Uint32Array} data.meta - Offsets, lengths and timestamps of the packets.
+   * @param {Object} [data.iface] - The interface the packets were captured on.
+   */
+  constructor({ buffer, meta, iface }) {
+    this.arena = buffer;
+    this.meta = meta;
+    this.iface = iface;
+    this._packets = new Array(this.length);
+  }
+
+  /**
+   * The number of packets in the batch.
+   * @type {number}
+   */
+  get length() {
+    return this.meta.length / FIELDS;
+  }
+
+  /**
+   * Raw bytes of the i-th packet, shares memory with the batch.
+   * @param {number} i
+   * @returns {Buffer}
+   */
+  buffer(i) {
+    const off = this.meta[i * FIELDS + OFFSET];
+    return this.arena.subarray(off, off + this.meta[i * FIELDS + LENGTH]);
+  }
+
+  /**
+   * Capture time of the i-th packet.
+   * @param {number} i
+   * @returns {TimeStamp}
+   */
+  timestamp(i) {
+    return new TimeStamp({ s: this.meta[i * FIELDS + TS_SEC], ns: this.meta[i * FIELDS + TS_NSEC] });
+  }
+
+  /**
+   * Length of the i-th packet on the wire.
+   * @param {number} i
+   * @returns {number}
+   */
+  origLength(i) {
+    return this.meta[i * FIELDS + ORIG_LENGTH];
+  }
+
+  /**
+   * The i-th packet of the batch.
+   * @param {number} i
+   * @returns {Packet}
+   */
+  get(i) {
+    if (!this._packets[i]) {
+      this._packets[i] = new Packet({
+        buffer: this.buffer(i),
+        iface: this.iface,
+        timestamp: this.timestamp(i),
+        origLength: this.origLength(i),
+      });
+    }
+    return this._packets[i];
+  }
+
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; ++i) {
+      yield this.get(i);
+    }
+  }
+
+  [Symbol.for('nodejs.util.inspect.custom')]() {
+    return `<PacketBatch | ${this.length} packets, ${this.arena.length} bytes>`;
+  }
+}
+
+module.exports = { PacketBatch };
@@ -0,0 +1,89 @@
+const { Replay: ReplayCxx } = require('#lib/bindings');
+const { LiveDevice } = require('#lib/liveDevice');
+const { pick } = require('#lib/pick');
+
+const replayModes = ['original', 'multiplier', 'pps', 'mbps', 'topspeed'];
+
+/**
+ * @typedef {Object} ReplayOptions
+ * @property {string} [mode] - How packets are paced: "original" (default, the timing of the capture), "multiplier" (the original timing sped up by multiplier), "pps" (a fixed packet rate), "mbps" (a fixed bit rate) or "topspeed" (as fast as the target takes them).
+ * @property {number} [multiplier] - Speed factor for the "multiplier" mode, 2 replays twice as fast.
+ * @property {number} [pps] - Packets per second for the "pps" mode.
+ * @property {number} [mbps] - Megabits per second for the "mbps" mode.
+ * @property {number} [loop] - How many times the file is replayed, 0 loops until stop() is called. Defaults to 1.
+ * @property {number} [batchSize] - Frames that are due at the same time go out in one send call, up to this many.
+ */
+
+/**
+ * @typedef {Object} ReplayStats
+ * @property {number} packets - The number of frames the target accepted.
+ * @property {number} bytes - The number of bytes the target accepted.
+ * @property {number} failed - The number of frames the target refused.
+ * @property {number} loops - The number of completed passes over the file.
+ * @property {number} elapsedSec - Time since start, until the end once the replay is over.
+ * @property {number} pps - The achieved packet rate.
+ * @property {number} mbps - The achieved bit rate in megabits per second.
+ * @property {number} timingErrorAvgUs - Average distance between the scheduled and the actual send time of a frame, in microseconds.
+ * @property {number} timingErrorMaxUs - The largest such distance, in microseconds.
+ * @property {boolean} running - Whether the replay is still going.
+ */
+
+/**
+ * Replays a pcap or pcapng file, tcpreplay-style. The file is read and sent on a
+ * native thread, no Packet objects are created and JS is not involved per frame.
+ * @example
+ * const replay = new Replay('capture.pcapng', dev, { mode: 'pps', pps: 100000, loop: 10 });
+ * const stats = await replay.start();
+ */
+class Replay {
+  /**
+   * @param {string} path - The pcap or pcapng file.
+   * @param {LiveDevice|Object} target - An open LiveDevice or a raw socket (socket.Socket), which has to be bound (packet sockets) or connected.
+   * @param {ReplayOptions} [options]
+   */
+  constructor(path, target, options = {}) {
+    const { mode = 'original' } = options;
+    if (!replayModes.includes(mode)) {
+      throw new Error(`Unknown replay mode ${mode}`);
+    }
+
+    this.path = path;
+    this.target = target;
+    this.mode = mode;
+
+    this.replayInternal = new ReplayCxx({
+      ...pick(options, 'multiplier', 'pps', 'mbps', 'loop', 'batchSize'),
+      path,
+      mode,
+      target: target instanceof LiveDevice ? target.pcapInternal : target,
+    });
+  }
+
+  /**
+   * Starts the replay.
+   * @returns {Promise<ReplayStats>} Resolves with the final statistics once every loop is sent or stop() was called.
+   */
+  start() {
+    if (this.target instanceof LiveDevice && !this.target.isOpen) {
+      return Promise.reject(new Error('Device is not open'));
+    }
+    return this.replayInternal.start();
+  }
+
+  /**
+   * Stops the replay, the promise returned by start() resolves shortly after.
+   */
+  stop() {
+    this.replayInternal.stop();
+  }
+
+  /**
+   * The statistics so far.
+   * @type {ReplayStats}
+   */
+  get stats() {
+    return this.replayInternal.stats;
+  }
+}
+
+module.exports = { Replay, replayModes };
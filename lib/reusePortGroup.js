@@ -0,0 +1,174 @@
+const os = require('node:os');
+const socket = require('#lib/socket');
+const { defaultFamily } = require('#lib/af');
+
+const { Socket, SockAddr } = socket;
+
+const reusePortModes = ['kernel', 'hash', 'cpu', 'queue'];
+
+// linux/filter.h
+const BPF_LD_W_ABS = 0x20;
+const BPF_ALU_MOD_K = 0x94;
+const BPF_JMP_JEQ_K = 0x15;
+const BPF_RET_K = 0x06;
+const BPF_RET_A = 0x16;
+const SKF_AD_OFF = -0x1000;
+const SKF_AD_QUEUE = 20;
+const SKF_AD_RXHASH = 32;
+const SKF_AD_CPU = 36;
+
+const ancillary = {
+  hash: SKF_AD_RXHASH,
+  cpu: SKF_AD_CPU,
+  queue: SKF_AD_QUEUE,
+};
+
+/**
+ * Builds the classic BPF program that picks the socket of a SO_REUSEPORT group.
+ * The program returns an index into the group, the order the sockets were bound in.
+ * @param {string} mode - "hash" (the flow hash of the device, RSS), "cpu" (the CPU that received it) or "queue" (its rx queue).
+ * @param {number} size - Number of sockets in the group.
+ * @returns {Buffer} The sock_filter instructions, for setsockopt(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF).
+ */
+function reusePortProgram(mode, size) {
+  if (!(mode in ancillary)) {
+    throw new Error(`Unknown reuseport mode ${mode}`);
+  }
+  const insns = [
+    [BPF_LD_W_ABS, 0, 0, (SKF_AD_OFF + ancillary[mode]) >>> 0],
+  ];
+  if (mode == 'hash') {
+    // no hash from the device, an index out of the group leaves the pick to the kernel
+    insns.push([BPF_JMP_JEQ_K, 2, 0, 0]);
+  }
+  insns.push(
+    [BPF_ALU_MOD_K, 0, 0, size],
+    [BPF_RET_A, 0, 0, 0],
+  );
+  if (mode == 'hash') {
+    insns.push([BPF_RET_K, 0, 0, size]);
+  }
+
+  // struct sock_filter { u16 code; u8 jt; u8 jf; u32 k; } in host byte order
+  const buf = Buffer.alloc(insns.length * 8);
+  const view = new DataView(buf.buffer, buf.byteOffset, buf.length);
+  const le = os.endianness() == 'LE';
+  insns.forEach(([code, jt, jf, k], i) => {
+    view.setUint16(i * 8, code, le);
+    view.setUint8(i * 8 + 2, jt);
+    view.setUint8(i * 8 + 3, jf);
+    view.setUint32(i * 8 + 4, k, le);
+  });
+  return buf;
+}
+
+/**
+ * @typedef {Object} ReusePortOptions
+ * @property {string} ip - The address to bind to.
+ * @property {number} port - The port to bind to, can't be 0, every socket needs the same one.
+ * @property {number} [type] - Defaults to SOCK_DGRAM.
+ * @property {number} [protocol] - Defaults to IPPROTO_UDP.
+ * All the other options are passed to every Socket.
+ */
+
+/**
+ * Creates a socket with SO_REUSEPORT set and binds it, the socket joins the
+ * group of every other such socket on the same address and port.
+ * A Socket can't be passed to a worker thread, each worker joins the group itself.
+ * @param {ReusePortOptions} options
+ * @returns {Socket}
+ */
+function joinReusePort({ ip, port, type = socket.SOCK_DGRAM, protocol = socket.IPPROTO_UDP, ...options }) {
+  if (!(port > 0)) {
+    throw new Error('A reuseport group needs a fixed port');
+  }
+  const domain = defaultFamily(ip);
+  const sock = new Socket({ ...options, domain, type, protocol });
+  try {
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1);
+    sock.bind(new SockAddr({ ip, port }));
+  } catch(err) {
+    sock.close();
+    throw err;
+  }
+  return sock;
+}
+
+/**
+ * @typedef {Object} ReusePortGroupOptions
+ * @property {number} [size] - Number of sockets, defaults to the number of CPUs.
+ * @property {string} [mode] - How datagrams are steered: "hash" (per flow, default), "cpu", "queue" or "kernel" (no program, the kernel hashes the 4-tuple).
+ * @property {Buffer} [program] - Custom sock_filter instructions instead of the mode.
+ * All the other ReusePortOptions are applied to every socket.
+ */
+
+/**
+ * A set of sockets bound to the same port with SO_REUSEPORT. The kernel spreads
+ * the incoming datagrams between them with an attached classic BPF program,
+ * so receiving can scale across cores.
+ *
+ * The program returns the index of a socket, the group is in bind order.
+ * With "cpu" socket i gets what CPU i received, so its consumer should run
+ * there, with "queue" what rx queue i received. With worker threads every worker
+ * creates its own socket with {@link joinReusePort}, one at a time and in
+ * order, and one of them attaches the program with {@link attachReusePort}.
+ */
+class ReusePortGroup {
+  /**
+   * Creates and binds the sockets, then attaches the program.
+   * @param {ReusePortGroupOptions} options
+   */
+  constructor({ size = os.availableParallelism?.() ?? os.cpus().length, mode = 'hash', program, ...options } = {}) {
+    if (!reusePortModes.includes(mode)) {
+      throw new Error(`Unknown reuseport mode ${mode}`);
+    }
+
+    this.mode = mode;
+
+    /**
+     * @type {Socket[]}
+     */
+    this.sockets = [];
+    try {
+      for (let i = 0; i < size; ++i) {
+        this.sockets.push(joinReusePort(options));
+      }
+      if (program || mode != 'kernel') {
+        attachReusePort(this.sockets[0], program ?? reusePortProgram(mode, size));
+      }
+    } catch(err) {
+      this.close();
+      throw err;
+    }
+  }
+
+  /**
+   * Number of sockets.
+   * @type {number}
+   */
+  get size() {
+    return this.sockets.length;
+  }
+
+  /**
+   * Closes every socket.
+   */
+  close() {
+    this.sockets.forEach(sock => sock.close());
+  }
+
+  [Symbol.iterator]() {
+    return this.sockets[Symbol.iterator]();
+  }
+}
+
+/**
+ * Attaches a steering program to the group of a bound socket.
+ * @param {Socket} sock - Any socket of the group.
+ * @param {Buffer} program - sock_filter instructions, see {@link reusePortProgram}.
+ */
+function attachReusePort(sock, program) {
+  sock.setsockopt(socket.SOL_SOCKET, socket.SO_ATTACH_REUSEPORT_CBPF, program);
+}
+
+module.exports = { ReusePortGroup, reusePortModes, reusePortProgram, joinReusePort, attachReusePort };
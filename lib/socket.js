@@ -1,7 +1,9 @@
 const { socket } = require('#lib/bindings');
 const { defaultFamily, updateDomain } = require('#lib/af');
+const { SocketBatch, segments } = require('#lib/socketBatch');
+const { SocketStream } = require('#lib/socketStream');
 
-const { SockAddr: SockAddrCxx } = socket;
+const { SockAddr: SockAddrCxx, Socket: SocketCxx } = socket;
 
 class SockAddr extends SockAddrCxx {
   constructor(obj) {
@@ -11,14 +13,84 @@ class SockAddr extends SockAddrCxx {
     }
   }
 
+  get ip() {
+    return super.ip;
+  }
+
   set ip(val) {
     if (this.domain == -1) {
       updateDomain(this, val);
     }
-    this.ip = ip;
+    // the native setter drops the resolved address
+    super.ip = val;
+  }
+};
+
+/**
+ * With `batchMode` set (an option or a property) the socket emits one
+ * 'batch' event with a {@link SocketBatch} per readable wakeup instead of
+ * a 'data' event per datagram.
+ *
+ * With `zeroCopy` set (Linux, UDP sockets) the packets are sent with
+ * MSG_ZEROCOPY. The written buffers stay referenced until the kernel is
+ * done with them, then a 'zerocopy' event reports { packets, copied },
+ * `copied` being the packets the kernel had to copy anyway.
+ * `zeroCopyStats` holds the totals.
+ *
+ * UDP segmentation offload (Linux): `write(buf, addr, segmentSize)` or
+ * `write([[buf, addr, segmentSize], ...])` sends the buffer as datagrams of
+ * segmentSize bytes with a single UDP_SEGMENT message. With `gro` set the
+ * kernel may coalesce received datagrams, a 'data' listener then gets the
+ * segment size as its third argument, see {@link segments}.
+ *
+ * `backend: 'uring'` (Linux 6.0+, construction only) runs the socket on
+ * io_uring: one multishot recvmsg over a ring of `uringBuffers` provided
+ * buffers, and one submission per write() for all of its packets. The
+ * completions are reaped in bulk, datagrams are delivered the same way
+ * as with the default 'poll' backend. zeroCopy has no effect there.
+ *
+ * The send queue can be bounded with `maxQueuePackets` and `maxQueueBytes`
+ * (0, the default, is unlimited). A write() that doesn't fit throws an
+ * error with code 'ENOBUFS' and `queued`, the number of its packets that
+ * were queued before the limit was hit. write() returns false once the
+ * queue is full, 'drain' is emitted when it's empty again. `queueStats`
+ * holds { packets, bytes, maxPackets, maxBytes }. A {@link SocketStream}
+ * wraps all of this into an object mode Duplex.
+ */
+class Socket extends SocketCxx {
+  /**
+   * Attaches a socket filter (Linux, SO_ATTACH_FILTER), the kernel drops
+   * whatever doesn't match before it's queued, copied or wakes anyone up.
+   * The filter sees what the socket gets: the link layer header on AF_PACKET,
+   * the IP header on raw IP sockets (compile those with LINKTYPE_DLT_RAW1).
+   * @param {BpfFilter|Buffer} filter - A BpfFilter or its bytecode.
+   * @param {Object} [options]
+   * @param {boolean} [options.lock] - Lock the filter (SO_LOCK_FILTER), it can't be changed or removed afterwards.
+   */
+  attachFilter(filter, { lock = false } = {}) {
+    return super.attachFilter(Buffer.isBuffer(filter) ? filter : filter.bytecode, lock);
+  }
+
+  emit(event, ...args) {
+    // the native side hands over the raw tables, the batch object is made here
+    if (event === 'batch' && !(args[0] instanceof SocketBatch)) {
+      return super.emit(event, new SocketBatch(...args));
+    }
+    return super.emit(event, ...args);
   }
 };
 
 socket.SockAddr = SockAddr;
+socket.Socket = Socket;
+socket.SocketBatch = SocketBatch;
+socket.segments = segments;
+socket.SocketStream = SocketStream;
 
 module.exports = socket;
+
+// built on the classes above, so it's loaded once they are exported
+const { ReusePortGroup, joinReusePort, attachReusePort, reusePortProgram } = require('#lib/reusePortGroup');
+socket.ReusePortGroup = ReusePortGroup;
+socket.joinReusePort = joinReusePort;
+socket.attachReusePort = attachReusePort;
+socket.reusePortProgram = reusePortProgram;
@@ -0,0 +1,162 @@
+// Layout of the meta and address tables, see cxx/transports/socket/SocketBatch.hpp
+const OFFSET = 0;
+const LENGTH = 1;
+const ADDR = 2;
+const SEGMENT = 3;
+const FIELDS = 4;
+
+const ADDR_ENTRY = 24;
+const NO_ADDR = 0xffffffff;
+
+function ipv6ToString(bytes) {
+  const groups = [];
+  for (let i = 0; i < 16; i += 2) {
+    groups.push(((bytes[i] << 8) | bytes[i + 1]).toString(16));
+  }
+
+  // the longest run of zero groups collapses into ::
+  let best = -1, bestLen = 1;
+  for (let i = 0; i < 8;) {
+    let j = i;
+    while (j < 8 && groups[j] === '0') ++j;
+    if (j - i > bestLen) {
+      best = i;
+      bestLen = j - i;
+    }
+    i = j + 1;
+  }
+
+  if (best < 0) {
+    return groups.join(':');
+  }
+  return `${groups.slice(0, best).join(':')}::${groups.slice(best + bestLen).join(':')}`;
+}
+
+/**
+ * Cuts a UDP GRO super-datagram back into the datagrams it was made of.
+ * The buffers share memory with the input.
+ * @param {Buffer} buffer
+ * @param {number} segmentSize - 0 when the datagram was not coalesced.
+ * @returns {Buffer[]}
+ */
+function segments(buffer, segmentSize) {
+  if (!segmentSize) {
+    return [buffer];
+  }
+  const res = [];
+  for (let off = 0; off < buffer.length; off += segmentSize) {
+    res.push(buffer.subarray(off, off + segmentSize));
+  }
+  return res;
+}
+
+/**
+ * @typedef {Object} BatchAddress
+ * @property {number} family - The address family (socket.AF_*).
+ * @property {number} port - The port, or the ethertype for packet sockets.
+ * @property {string} [ip] - Set for AF_INET and AF_INET6 peers.
+ * @property {Buffer} [raw] - The rest of sockaddr_ll (ifindex, hatype, pkttype, halen, addr) for packet sockets.
+ */
+
+/**
+ * Every datagram read from a socket on one readable wakeup.
+ * The datagrams share one contiguous buffer, the peers are stored once
+ * per batch and decoded only when they are accessed.
+ */
+class SocketBatch {
+  /**
+   * @param {Buffer} buffer - The datagrams, back to back.
+   * @param {Uint32Array} meta - Offsets, lengths and peer indices of the datagrams.
+   * @param {Buffer} addrs - The table of distinct peers.
+   */
+  constructor(buffer, meta, addrs) {
+    this.arena = buffer;
+    this.meta = meta;
+    this.addrs = addrs;
+    this._addrs = new Array(addrs.length / ADDR_ENTRY);
+  }
+
+  /**
+   * The number of datagrams in the batch.
+   * @type {number}
+   */
+  get length() {
+    return this.meta.length / FIELDS;
+  }
+
+  /**
+   * The i-th datagram, shares memory with the batch.
+   * @param {number} i
+   * @returns {Buffer}
+   */
+  buffer(i) {
+    const off = this.meta[i * FIELDS + OFFSET];
+    return this.arena.subarray(off, off + this.meta[i * FIELDS + LENGTH]);
+  }
+
+  /**
+   * The UDP GRO segment size of the i-th datagram, 0 when it wasn't coalesced.
+   * @param {number} i
+   * @returns {number}
+   */
+  segmentSize(i) {
+    return this.meta[i * FIELDS + SEGMENT];
+  }
+
+  /**
+   * The i-th datagram cut into its GRO segments.
+   * @param {number} i
+   * @returns {Buffer[]}
+   */
+  segments(i) {
+    return segments(this.buffer(i), this.segmentSize(i));
+  }
+
+  /**
+   * The peer the i-th datagram came from, undefined on connected sockets.
+   * Datagrams from the same peer share the object.
+   * @param {number} i
+   * @returns {BatchAddress|undefined}
+   */
+  address(i) {
+    const idx = this.meta[i * FIELDS + ADDR];
+    if (idx === NO_ADDR) {
+      return undefined;
+    }
+    if (!this._addrs[idx]) {
+      this._addrs[idx] = this._decode(idx * ADDR_ENTRY);
+    }
+    return this._addrs[idx];
+  }
+
+  _decode(off) {
+    const entry = this.addrs.subarray(off, off + ADDR_ENTRY);
+    const family = entry.readUInt16BE(0);
+    const port = entry.readUInt16BE(2);
+    const ipLength = entry[4];
+    const addr = entry.subarray(8);
+
+    if (ipLength == 4) {
+      return { family, port, ip: addr.subarray(0, 4).join('.') };
+    }
+    if (ipLength == 16) {
+      return { family, port, ip: ipv6ToString(addr) };
+    }
+    return { family, port, raw: addr };
+  }
+
+  /**
+   * Yields [buffer, address, segmentSize], the same arguments a 'data' listener gets.
+   */
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; ++i) {
+      yield [this.buffer(i), this.address(i), this.segmentSize(i)];
+    }
+  }
+
+  [Symbol.for('nodejs.util.inspect.custom')]() {
+    return `<SocketBatch | ${this.length} datagrams, ${this.arena.length} bytes>`;
+  }
+}
+
+module.exports = { SocketBatch, segments };
@@ -0,0 +1,123 @@
+const { Duplex } = require('stream');
+
+/**
+ * @typedef {Object} Datagram
+ * @property {Buffer} data
+ * @property {Object} [address] - The peer, a SockAddr. Not needed on connected sockets.
+ * @property {number} [segmentSize] - UDP GSO/GRO segment size.
+ */
+
+/**
+ * An object mode Duplex over a Socket. Writes are handed to the socket in
+ * one write() per batch of buffered chunks, and a batch is done only when
+ * the socket has sent it ('drain'), so a producer that respects write()'s
+ * return value is slowed down to what the socket can take. Reads pause
+ * the socket when the readable side is over its highWaterMark.
+ *
+ * Chunks are {@link Datagram} objects or [data, address, segmentSize] arrays.
+ */
+class SocketStream extends Duplex {
+  /**
+   * @param {Object} socket - A socket.Socket.
+   * @param {Object} [options] - Duplex options, objectMode is always on.
+   */
+  constructor(socket, options = {}) {
+    super({ ...options, objectMode: true });
+    this.socket = socket;
+    this._pending = null;
+    this._rest = [];
+
+    this._onData = (data, address, segmentSize) => this._pushDatagram({ data, address, segmentSize });
+    this._onBatch = (batch) => {
+      for (const [data, address, segmentSize] of batch) {
+        this._pushDatagram({ data, address, segmentSize });
+      }
+    };
+    this._onDrain = () => this._settle(null);
+    this._onError = (err) => {
+      if (this._pending) {
+        this._settle(typeof err == 'string' ? new Error(err) : err);
+      }
+      else {
+        this.destroy(typeof err == 'string' ? new Error(err) : err);
+      }
+    };
+
+    socket.on('data', this._onData);
+    socket.on('batch', this._onBatch);
+    socket.on('drain', this._onDrain);
+    socket.on('error', this._onError);
+  }
+
+  _pushDatagram(datagram) {
+    if (!datagram.segmentSize) {
+      delete datagram.segmentSize;
+    }
+    if (!this.push(datagram)) {
+      this.socket.pause();
+    }
+  }
+
+  _read() {
+    this.socket.resume();
+  }
+
+  _settle(err) {
+    if (!err && this._rest.length > 0) {
+      return this._flush();
+    }
+    const cb = this._pending;
+    this._pending = null;
+    this._rest = [];
+    if (cb) {
+      cb(err);
+    }
+  }
+
+  _flush() {
+    const packets = this._rest;
+    this._rest = [];
+    try {
+      this.socket.write(packets);
+    }
+    catch (err) {
+      // a batch over the queue limits goes out in parts, one per 'drain',
+      // only a packet that doesn't fit in an empty queue is an error
+      if (err.code != 'ENOBUFS' || this.socket.queueStats.packets == 0) {
+        return this._settle(err);
+      }
+      this._rest = packets.slice(err.queued);
+    }
+  }
+
+  _writev(chunks, cb) {
+    this._rest = chunks.map(({ chunk }) => {
+      if (Array.isArray(chunk)) {
+        return chunk;
+      }
+      return chunk.segmentSize ? [chunk.data, chunk.address, chunk.segmentSize] : [chunk.data, chunk.address];
+    });
+    this._pending = cb;
+    this._flush();
+
+    // nothing left in flight, there won't be a 'drain'
+    if (this._pending && this.socket.queueStats.packets == 0) {
+      this._settle(null);
+    }
+  }
+
+  _write(chunk, encoding, cb) {
+    this._writev([{ chunk, encoding }], cb);
+  }
+
+  _destroy(err, cb) {
+    this.socket.off('data', this._onData);
+    this.socket.off('batch', this._onBatch);
+    this.socket.off('drain', this._onDrain);
+    this.socket.off('error', this._onError);
+    this.socket.close();
+    cb(err);
+  }
+}
+
+module.exports = { SocketStream };
@@ -0,0 +1,67 @@
+// node test/bpfFilter.bench.js [packets]
+// Matches per second of BpfFilter over the packets of test.pcapng:
+// match() per packet, matchMany() through libpcap and through the native engine.
+const path = require('node:path');
+const fs = require('node:fs');
+const { pipeline } = require('node:stream/promises');
+
+const { BpfFilter } = require('#lib/bpfFilter');
+const { createReadStream } = require('#lib/pcapFile/index');
+
+const expressions = [
+  'tcp port 443',
+  'udp and dst port 53',
+  'ip src 192.168.1.101 or ip dst 192.168.1.101',
+  'tcp[tcpflags] & (tcp-syn|tcp-fin) != 0',
+];
+
+const measure = (n, fn) => {
+  const start = process.hrtime.bigint();
+  fn();
+  const ns = Number(process.hrtime.bigint() - start);
+  return (n / ns * 1e9 / 1e6).toFixed(2);
+};
+
+(async () => {
+  const total = Number(process.argv[2] ?? 1_000_000);
+  const sample = [];
+  await pipeline(
+    fs.createReadStream(path.join(__dirname, 'test.pcapng')),
+    createReadStream({ format: 'pcapng' }),
+    async function(source) {
+      for await (const pkt of source) {
+        sample.push(pkt.buffer);
+      }
+    },
+  );
+  const buffers = Array.from({ length: total }, (_, i) => sample[i % sample.length]);
+
+  // the contiguous layout of a capture batch
+  const arena = Buffer.concat(sample);
+  const offsets = new Uint32Array(total * 2);
+  const sampleOffsets = [];
+  sample.reduce((off, buf) => (sampleOffsets.push(off), off + buf.length), 0);
+  for (let i = 0; i < total; ++i) {
+    offsets[i * 2] = sampleOffsets[i % sample.length];
+    offsets[i * 2 + 1] = sample[i % sample.length].length;
+  }
+
+  console.log(`${total} packets, millions of matches per second`);
+  const rows = {};
+  for (const expr of expressions) {
+    const filter = new BpfFilter(expr);
+    const row = {};
+
+    filter.engine = 'pcap';
+    row['match() pcap'] = measure(total, () => buffers.forEach(buf => filter.match(buf)));
+    row['matchMany pcap'] = measure(total, () => filter.matchMany(arena, offsets));
+
+    filter.engine = 'native';
+    row['match() native'] = measure(total, () => buffers.forEach(buf => filter.match(buf)));
+    row['matchMany native'] = measure(total, () => filter.matchMany(arena, offsets));
+    row['matchMany native, array'] = measure(total, () => filter.matchMany(buffers));
+
+    rows[expr] = row;
+  }
+  console.table(rows);
+})();
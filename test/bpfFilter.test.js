@@ -1,9 +1,13 @@
 const { strict: assert } = require('node:assert');
 const test = require('node:test');
+const path = require('node:path');
+const fs = require('node:fs');
+const { pipeline } = require('node:stream/promises');
 
 const defaults = require('#lib/defaults');
 const { Packet } = require('#lib/packet');
 const { BpfFilter } = require('#lib/bpfFilter');
+const { createReadStream } = require('#lib/pcapFile/index');
 
 const pktBuf = () => 
   Buffer.from('424242424242424242424242080045000034000040004006a79ac0a80165a5162c06cd8e5debee16992ebea89919801008000d1200000101080a52d3c650dd04cdd6', 'hex');
@@ -31,3 +35,116 @@ test('BPF filter', async (t) => {
   assert.ok(!new BpfFilter('ip src 127.0.0.1').match(pkt));
   console.timeEnd('negative match ip');
 });
+
+test('BPF filter bytecode', async (t) => {
+  const pkt = new Packet({
+    buffer: pktBuf(),
+  });
+
+  const filter = new BpfFilter('tcp port 52622');
+  const { bytecode } = filter;
+  assert.ok(bytecode.length > 0);
+  assert.equal(bytecode.length % 8, 0);
+
+  const loaded = new BpfFilter(bytecode);
+  assert.equal(loaded.value, '');
+  assert.deepEqual(loaded.bytecode, bytecode);
+  assert.ok(loaded.match(pkt));
+
+  loaded.bytecode = new BpfFilter('tcp port 80').bytecode;
+  assert.ok(!loaded.match(pkt));
+
+  assert.throws(() => new BpfFilter(Buffer.alloc(7)));
+  // ja +16, past the end of the program
+  assert.throws(() => new BpfFilter(Buffer.from('0500000010000000', 'hex')));
+});
+
+test('BPF filter matchMany', async (t) => {
+  const tcp = pktBuf();
+  const other = Buffer.from(tcp);
+  // a different source port
+  other.writeUInt16BE(80, 34);
+
+  const filter = new BpfFilter('tcp port 52622');
+  const packets = [tcp, other, new Packet({ buffer: pktBuf() }), other, tcp, other, other, other, tcp];
+
+  assert.deepEqual(filter.matchMany(packets), new Uint8Array([0b00010101, 0b1]));
+  assert.deepEqual(filter.matchMany(packets, { indices: true }), new Uint32Array([0, 2, 4, 8]));
+
+  const arena = Buffer.concat([other, tcp, other]);
+  const table = new Uint32Array([0, other.length, other.length, tcp.length, other.length * 2, other.length]);
+  assert.deepEqual(filter.matchMany(arena, table, { indices: true }), new Uint32Array([1]));
+  assert.throws(() => filter.matchMany(arena, new Uint32Array([arena.length, 1])), RangeError);
+
+  assert.deepEqual(new BpfFilter().matchMany([tcp, other], { indices: true }), new Uint32Array([0, 1]));
+});
+
+const expressions = [
+  'tcp',
+  'udp port 53',
+  'tcp port 443 or tcp port 80',
+  'ip src 192.168.1.101',
+  'net 10.0.0.0/8 and not icmp',
+  'tcp[tcpflags] & (tcp-syn|tcp-fin) != 0',
+  'ip6 and udp',
+  'arp or (ip and ip[8] < 64)',
+  'greater 100 and vlan',
+  'len < 60',
+];
+
+test('BPF engine against libpcap', async (t) => {
+  const buffers = [];
+  await pipeline(
+    fs.createReadStream(path.join(__dirname, 'test.pcapng')),
+    createReadStream({ format: 'pcapng' }),
+    async function(source) {
+      for await (const pkt of source) {
+        buffers.push(pkt.buffer);
+      }
+    },
+  );
+  assert.ok(buffers.length > 0);
+
+  for (const expr of expressions) {
+    const filter = new BpfFilter(expr);
+    assert.equal(filter.engine, 'native', expr);
+    const native = filter.matchMany(buffers);
+    const single = buffers.map(buf => filter.match(buf));
+
+    filter.engine = 'pcap';
+    assert.equal(filter.engine, 'pcap');
+    assert.deepEqual(native, filter.matchMany(buffers), expr);
+    assert.deepEqual(single, buffers.map(buf => filter.match(buf)), expr);
+  }
+
+  assert.throws(() => new BpfFilter('tcp').engine = 'jit', /Unknown engine/);
+});
+
+test('BPF filter cache', async (t) => {
+  BpfFilter.clearCache();
+  BpfFilter.warm(['tcp port 52622', 'udp port 53']);
+  assert.deepEqual(BpfFilter.cacheStats(), { hits: 0, misses: 2, size: 2, capacity: 1024 });
+
+  const pkt = new Packet({ buffer: pktBuf() });
+  const filter = new BpfFilter('tcp port 52622');
+  assert.ok(filter.match(pkt));
+  assert.deepEqual(new BpfFilter('tcp port 52622').bytecode, filter.bytecode);
+  assert.equal(BpfFilter.cacheStats().hits, 2);
+
+  // another snaplen is another program
+  new BpfFilter('tcp port 52622', undefined, 128);
+  assert.equal(BpfFilter.cacheStats().misses, 3);
+
+  // errors aren't cached
+  assert.throws(() => BpfFilter.warm(['tcp port']), /tcp port/);
+  assert.equal(BpfFilter.cacheStats().size, 3);
+
+  BpfFilter.setCacheCapacity(1);
+  assert.equal(BpfFilter.cacheStats().size, 1);
+  // filters keep their program when it's dropped
+  assert.ok(filter.match(pkt));
+
+  BpfFilter.setCacheCapacity(1024);
+  BpfFilter.clearCache();
+  assert.deepEqual(BpfFilter.cacheStats(), { hits: 0, misses: 0, size: 0, capacity: 1024 });
+});
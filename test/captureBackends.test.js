@@ -0,0 +1,127 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const os = require('node:os');
+const { execFileSync } = require('node:child_process');
+
+const { LiveDevice } = require('#lib/liveDevice');
+const { PacketBatch } = require('#lib/packetBatch');
+const { Socket, SockAddr, AF_INET, SOCK_DGRAM, IPPROTO_UDP } = require('#lib/socket');
+
+const unprivileged = /not permitted|denied/i;
+
+// the device list is read once, on the first device, so the veth pair has to exist before that
+const veth = [`npxa${process.pid % 10000}`, `npxb${process.pid % 10000}`];
+let vethError;
+
+test.before(() => {
+  if (os.platform() != 'linux') return;
+  try {
+    execFileSync('ip', ['link', 'add', veth[0], 'type', 'veth', 'peer', 'name', veth[1]], { stdio: 'pipe' });
+    execFileSync('ip', ['link', 'set', veth[0], 'up'], { stdio: 'pipe' });
+    execFileSync('ip', ['link', 'set', veth[1], 'up'], { stdio: 'pipe' });
+  } catch (err) {
+    vethError = err.stderr?.toString().trim() || err.message;
+  }
+});
+
+test.after(() => {
+  if (os.platform() != 'linux' || vethError) return;
+  execFileSync('ip', ['link', 'del', veth[0]], { stdio: 'pipe' });
+});
+
+// resolves with the first batch holding a frame that matches, rejects with the device error
+const capture = (dev, match) => new Promise((resolve, reject) => {
+  dev.once('error', reject);
+  dev.on('data', batch => {
+    for (let i = 0; i < batch.length; ++i) {
+      if (match(batch.buffer(i))) {
+        return resolve(batch);
+      }
+    }
+  });
+});
+
+// keeps sending until the capture is up and got a copy
+const until = async (promise, send) => {
+  const timer = setInterval(send, 50);
+  send();
+  try {
+    return await promise;
+  } finally {
+    clearInterval(timer);
+  }
+};
+
+test('LiveDevice tpacket backend', async (t) => {
+  if (os.platform() != 'linux') return;
+
+  const port = 30000 + (process.pid + 11) % 20000;
+  const probe = Buffer.from(`tpacket probe ${process.pid}`);
+
+  const dev = new LiveDevice({
+    iface: 'lo',
+    backend: 'tpacket',
+    tpacketRetireTimeoutMs: 10,
+    filter: `udp port ${port}`,
+  });
+
+  const client = new Socket({ domain: AF_INET, type: SOCK_DGRAM, protocol: IPPROTO_UDP });
+  const target = new SockAddr({ ip: '127.0.0.1', port });
+
+  try {
+    const batch = await until(capture(dev, buf => buf.includes(probe)), () => client.write(probe, target));
+    assert.ok(batch instanceof PacketBatch);
+  } catch (err) {
+    dev.destroy();
+    if (unprivileged.test(err.message)) {
+      return t.skip(`tpacket needs privileges: ${err.message}`);
+    }
+    throw err;
+  } finally {
+    client.close();
+  }
+
+  const { ringDrops, ringFreezes, ringStalls } = dev.stats;
+  assert.equal(ringDrops, 0);
+  assert.equal(ringFreezes, 0);
+  assert.equal(typeof ringStalls, 'number');
+
+  dev.destroy();
+});
+
+test('LiveDevice xdp backend', async (t) => {
+  if (os.platform() != 'linux') return;
+  if (vethError) {
+    return t.skip(`no veth pair: ${vethError}`);
+  }
+
+  // broadcast, locally administered source, local experimental ethertype
+  const probe = Buffer.from(`xdp probe ${process.pid}`);
+  const frame = Buffer.alloc(60);
+  frame.fill(0xff, 0, 6);
+  Buffer.from([0x02, 0, 0, 0, 0, 1]).copy(frame, 6);
+  frame.writeUInt16BE(0x88b5, 12);
+  probe.copy(frame, 14);
+
+  const dev = new LiveDevice({ iface: veth[0], backend: 'xdp', xdpMode: 'copy', xdpQueue: 0 });
+  const peer = new LiveDevice({ iface: veth[1], capture: false });
+
+  try {
+    const batch = await until(capture(dev, buf => buf.includes(probe)), () => peer.write(frame));
+    assert.ok(batch instanceof PacketBatch);
+  } catch (err) {
+    dev.destroy();
+    if (unprivileged.test(err.message)) {
+      return t.skip(`xdp needs privileges: ${err.message}`);
+    }
+    throw err;
+  } finally {
+    peer.destroy();
+  }
+
+  const { ringFull, invalidDescs } = dev.stats;
+  assert.equal(ringFull, 0);
+  assert.equal(invalidDescs, 0);
+
+  dev.destroy();
+});
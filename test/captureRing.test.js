@@ -0,0 +1,61 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+
+const { CaptureRing } = require('#lib/captureRing');
+
+// Mimics the native producer from cxx/transports/pcap/CaptureRing.cpp
+const produce = (ring, frame, ts = 0) => {
+  const u32 = new Uint32Array(ring.memory);
+  const capacity = u32[2];
+  const head = u32[16];
+  const pos = head & (capacity - 1);
+  const need = (16 + frame.length + 7) & ~7;
+  const toEnd = capacity - pos;
+  const data = new Uint32Array(ring.memory, 192);
+  let at = pos;
+  let newHead = head;
+  if (toEnd < need) {
+    data[pos / 4] = 0xffffffff;
+    newHead += toEnd;
+    at = 0;
+  }
+  data.set([frame.length, frame.length + 1, ts, 0], at / 4);
+  Buffer.from(ring.memory, 192 + at + 16, frame.length).set(frame);
+  Atomics.store(u32, 16, (newHead + need) >>> 0);
+};
+
+test('CaptureRing', async (t) => {
+  const ring = CaptureRing.create({ size: 192 + 256 });
+  const u32 = new Uint32Array(ring.memory);
+  u32[2] = 256;
+  u32[4] = 1;
+  u32[0] = 0x5257544f;
+
+  assert.equal(ring.next(), null);
+
+  produce(ring, Buffer.alloc(100, 1), 42);
+  produce(ring, Buffer.alloc(50, 2));
+
+  const fst = ring.next();
+  assert.equal(fst.buffer.length, 100);
+  assert.equal(fst.buffer[0], 1);
+  assert.equal(fst.origLength, 101);
+  assert.equal(fst.timestamp.s, 42);
+  assert.equal(ring.read(rec => assert.equal(rec.buffer[49], 2)), 1);
+  assert.equal(u32[32], u32[16]);
+
+  // does not fit into the tail of the ring, has to wrap
+  produce(ring, Buffer.alloc(120, 3));
+  const wrapped = ring.next();
+  assert.equal(wrapped.buffer.length, 120);
+  assert.equal(wrapped.buffer[119], 3);
+  ring.release();
+
+  const shared = CaptureRing.from(ring.memory);
+  assert.equal(shared.capacity, 256);
+  assert.throws(() => CaptureRing.from(new SharedArrayBuffer(1024)));
+
+  const waiting = ring.wait();
+  setImmediate(() => ring.notify());
+  await waiting;
+});
@@ -0,0 +1,32 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const os = require('node:os');
+
+const { FanoutGroup } = require('#lib/fanoutGroup');
+
+test('FanoutGroup', (t) => {
+  assert.throws(() => new FanoutGroup({ iface: 'lo', mode: 'bogus' }), /Unknown fanout mode/);
+  assert.throws(() => new FanoutGroup({ iface: 'lo', id: 0x10000 }), RangeError);
+  assert.throws(() => new FanoutGroup({ iface: 'lo', id: 1.5 }), RangeError);
+  assert.throws(() => new FanoutGroup({ iface: 'lo', id: '1' }), TypeError);
+
+  if (os.platform() != 'linux') return;
+
+  const [ifaceName] = Object.entries(os.networkInterfaces()).find(([name, data]) => data.some(e => e.internal)) ?? [];
+  if (!ifaceName) return;
+
+  try {
+    const group = new FanoutGroup({ iface: ifaceName, shards: 2, mode: 'lb' });
+    assert.equal(group.size, 2);
+    assert.equal(group.devices.length, 2);
+    group.devices.forEach(dev => assert.equal(dev.backend, 'tpacket'));
+
+    group.devices.forEach(dev => dev.on('error', err => {
+      console.log('caught error', err.message);
+    }));
+
+    group.destroy();
+  } catch(err) {
+    console.log('try-catch', err);
+  }
+});
@@ -0,0 +1,69 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const path = require('node:path');
+const fs = require('node:fs');
+const { pipeline } = require('node:stream/promises');
+
+const { Packet } = require('#lib/packet');
+const { BpfFilter } = require('#lib/bpfFilter');
+const { FilterSet } = require('#lib/filterSet');
+const { createReadStream } = require('#lib/pcapFile/index');
+
+const pktBuf = () => 
+  Buffer.from('424242424242424242424242080045000034000040004006a79ac0a80165a5162c06cd8e5debee16992ebea89919801008000d1200000101080a52d3c650dd04cdd6', 'hex');
+
+test('FilterSet', async (t) => {
+  assert.throws(() => new FilterSet(['tcp', 'hello how are you']), /Error compiling filter 1/);
+
+  const set = new FilterSet({
+    client: 'ip src 192.168.1.101',
+    web: 'tcp port 80',
+    tcp: 'tcp',
+    dns: 'udp port 53',
+    port: 'tcp port 52622',
+    same: 'tcp',
+  });
+  assert.equal(set.size, 6);
+  assert.equal(set.words, 1);
+  assert.equal(set.stats.programs, 5);
+  assert.ok(set.stats.sharedChecks <= set.stats.checks);
+
+  const pkt = new Packet({ buffer: pktBuf() });
+  const mask = set.match(pkt);
+  assert.deepEqual(set.labelsOf(mask), ['client', 'tcp', 'port', 'same']);
+
+  const many = set.matchMany([pktBuf(), Buffer.alloc(10)]);
+  assert.equal(many.length, 2);
+  assert.deepEqual(set.labelsOf(many, 0), ['client', 'tcp', 'port', 'same']);
+  assert.deepEqual(set.labelsOf(many, 1), []);
+});
+
+test('FilterSet against BpfFilter', async (t) => {
+  const buffers = [];
+  await pipeline(
+    fs.createReadStream(path.join(__dirname, 'test.pcapng')),
+    createReadStream({ format: 'pcapng' }),
+    async function(source) {
+      for await (const pkt of source) {
+        buffers.push(pkt.buffer);
+      }
+    },
+  );
+
+  // more than one word of labels
+  const expressions = [];
+  for (let port = 1; port <= 40; ++port) {
+    expressions.push(`tcp port ${port * 11}`, `udp and dst port ${port * 13}`);
+  }
+  expressions.push('ip', 'ip6', 'arp', 'tcp[tcpflags] & tcp-syn != 0', 'len > 500', 'net 192.168.0.0/16');
+
+  const set = new FilterSet(expressions);
+  assert.equal(set.words, Math.ceil(expressions.length / 32));
+  const masks = set.matchMany(buffers);
+
+  expressions.forEach((expr, i) => {
+    const expected = new BpfFilter(expr).matchMany(buffers, { indices: true });
+    const got = buffers.map((_, j) => j).filter(j => masks[j * set.words + (i >> 5)] & (1 << (i & 31)));
+    assert.deepEqual(got, [...expected], expr);
+  });
+});
@@ -0,0 +1,35 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+
+const { Packet } = require('#lib/packet');
+const { PacketBatch } = require('#lib/packetBatch');
+
+const pktBuf = () => 
+  Buffer.from('424242424242424242424242080045000034000040004006a79ac0a80165a5162c06cd8e5debee16992ebea89919801008000d1200000101080a52d3c650dd04cdd6', 'hex');
+
+test('PacketBatch', async (t) => {
+  const fst = pktBuf();
+  const snd = pktBuf().subarray(0, 34);
+
+  const buffer = Buffer.concat([fst, snd]);
+  const meta = new Uint32Array([
+    0, fst.length, fst.length, 1700000000, 500,
+    fst.length, snd.length, 1500, 1700000001, 0,
+  ]);
+
+  const batch = new PacketBatch({ buffer, meta });
+
+  assert.equal(batch.length, 2);
+  assert.deepEqual(batch.buffer(0), fst);
+  assert.deepEqual(batch.buffer(1), snd);
+  assert.equal(batch.origLength(1), 1500);
+  assert.equal(batch.timestamp(0).ns, 1700000000n * BigInt(1e9) + 500n);
+
+  const pkt = batch.get(0);
+  assert.ok(pkt instanceof Packet);
+  assert.equal(batch.get(0), pkt);
+  assert.equal(pkt.layers.IPv4.src, '192.168.1.101');
+  assert.equal(batch.get(1).origLength, 1500);
+
+  assert.equal([...batch].length, 2);
+});
@@ -0,0 +1,47 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const path = require('node:path');
+const os = require('node:os');
+
+const { Replay } = require('#lib/replay');
+const { LiveDevice } = require('#lib/liveDevice');
+
+const file = path.join(__dirname, 'test.pcapng');
+
+test('Replay', async (t) => {
+  assert.throws(() => new Replay(file, {}, { mode: 'bogus' }), /Unknown replay mode/);
+  assert.throws(() => new Replay(file, {}, { mode: 'pps' }), /must be positive/);
+
+  const [ifaceName] = Object.entries(os.networkInterfaces()).find(([name, data]) => data.some(e => e.internal)) ?? [];
+  if (!ifaceName) return;
+
+  try {
+    const dev = new LiveDevice({ iface: ifaceName, capture: false });
+    dev.on('error', err => {
+      console.log('caught error', err.message);
+    });
+
+    const replay = new Replay(file, dev, { mode: 'topspeed', loop: 2 });
+    await assert.rejects(replay.start(), /Device is not open/);
+
+    await new Promise(resolve => setImmediate(resolve));
+    if (dev.isOpen) {
+      const stats = await replay.start();
+      assert.equal(stats.loops, 2);
+      assert.equal(stats.running, false);
+      assert.equal(stats.packets + stats.failed > 0, true);
+
+      // the device halts a replay that would never end before it closes
+      const endless = new Replay(file, dev, { mode: 'pps', pps: 1000, loop: 0 });
+      const running = endless.start();
+      assert.throws(() => endless.start(), /already running/);
+      dev.destroy();
+      const last = await running;
+      assert.equal(last.running, false);
+    }
+
+    dev.destroy();
+  } catch(err) {
+    console.log('try-catch', err);
+  }
+});
@@ -0,0 +1,43 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const os = require('node:os');
+
+const { ReusePortGroup, reusePortProgram } = require('#lib/reusePortGroup');
+const { Socket, SockAddr, AF_INET, SOCK_DGRAM, IPPROTO_UDP } = require('#lib/socket');
+
+test('reusePortProgram', () => {
+  assert.throws(() => reusePortProgram('bogus', 2), /Unknown reuseport mode/);
+  // ld cpu, mod #4, ret a
+  assert.equal(reusePortProgram('cpu', 4).length, 3 * 8);
+  // ld rxhash, jeq #0, mod #4, ret a, ret #4
+  assert.equal(reusePortProgram('hash', 4).length, 5 * 8);
+});
+
+test('ReusePortGroup', async (t) => {
+  assert.throws(() => new ReusePortGroup({ ip: '127.0.0.1', port: 1, mode: 'bogus' }), /Unknown reuseport mode/);
+  assert.throws(() => new ReusePortGroup({ ip: '127.0.0.1', port: 0 }), /fixed port/);
+
+  if (os.platform() != 'linux') return;
+
+  const port = 30000 + process.pid % 20000;
+  const group = new ReusePortGroup({ ip: '127.0.0.1', port, size: 2, mode: 'hash' });
+  assert.equal(group.size, 2);
+
+  let received = 0;
+  const done = new Promise(resolve => {
+    for (const sock of group) {
+      sock.on('data', () => ++received == 8 && resolve());
+      sock.resume();
+    }
+  });
+
+  const target = new SockAddr({ ip: '127.0.0.1', port });
+  for (let i = 0; i < 8; ++i) {
+    const client = new Socket({ domain: AF_INET, type: SOCK_DGRAM, protocol: IPPROTO_UDP });
+    client.write(Buffer.from([i]), target);
+    client.on('drain', () => client.close());
+  }
+
+  await done;
+  group.close();
+});
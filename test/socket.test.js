@@ -0,0 +1,164 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+const os = require('node:os');
+const { once } = require('node:events');
+
+const { Socket, SockAddr, segments, AF_INET, SOCK_DGRAM, SOCK_RAW, IPPROTO_UDP, SOL_SOCKET, SO_RCVBUF } = require('#lib/socket');
+const { BpfFilter } = require('#lib/bpfFilter');
+const { LinkLayerType } = require('#lib/enums');
+
+const basePort = 30000 + (process.pid + 7) % 20000;
+
+const udpSocket = (options = {}) => new Socket({ domain: AF_INET, type: SOCK_DGRAM, protocol: IPPROTO_UDP, ...options });
+
+const listen = (port, options) => {
+  const sock = udpSocket(options);
+  sock.bind(new SockAddr({ ip: '127.0.0.1', port }));
+  sock.resume();
+  return sock;
+};
+
+test('Socket zeroCopy', async (t) => {
+  if (os.platform() != 'linux') return;
+
+  const port = basePort;
+  const server = listen(port);
+  const client = udpSocket({ zeroCopy: true });
+  assert.equal(client.zeroCopy, true);
+
+  const received = once(server, 'data');
+  const completed = once(client, 'zerocopy');
+  client.write(Buffer.alloc(1000, 1), new SockAddr({ ip: '127.0.0.1', port }));
+
+  const [buf] = await received;
+  assert.deepEqual(buf, Buffer.alloc(1000, 1));
+
+  // loopback copies, the completion arrives all the same
+  const [{ packets, copied }] = await completed;
+  assert.equal(packets, 1);
+  assert.ok(copied <= packets);
+
+  const stats = client.zeroCopyStats;
+  assert.equal(stats.sent, 1);
+  assert.equal(stats.completed, 1);
+  assert.equal(stats.copied, copied);
+  assert.equal(stats.inflight, 0);
+
+  client.close();
+  server.close();
+});
+
+test('Socket segmentation offload', async (t) => {
+  if (os.platform() != 'linux') return;
+
+  const port = basePort + 1;
+  const server = listen(port, { gro: true });
+  const client = udpSocket();
+
+  const payload = Buffer.alloc(4000);
+  for (let i = 0; i < payload.length; ++i) {
+    payload[i] = i % 251;
+  }
+
+  const chunks = [];
+  const sizes = [];
+  const done = new Promise(resolve => {
+    let total = 0;
+    server.on('data', (buf, addr, segmentSize) => {
+      chunks.push(...segments(buf, segmentSize ?? 0));
+      sizes.push(segmentSize);
+      if ((total += buf.length) == payload.length) resolve();
+    });
+  });
+  client.write(payload, new SockAddr({ ip: '127.0.0.1', port }), 1000);
+
+  await done;
+  // loopback keeps the GSO packet whole, the receiver gets it coalesced
+  assert.deepEqual(sizes, [1000]);
+  assert.equal(chunks.length, 4);
+  assert.deepEqual(Buffer.concat(chunks), payload);
+
+  client.close();
+  server.close();
+});
+
+test('Socket on io_uring', async (t) => {
+  if (os.platform() != 'linux') return;
+
+  const port = basePort + 2;
+  let server, client;
+  try {
+    server = udpSocket({ backend: 'uring' });
+    client = udpSocket({ backend: 'uring' });
+  } catch (err) {
+    server?.close();
+    return t.skip(`no io_uring: ${err.message}`);
+  }
+  assert.equal(server.backend, 'uring');
+
+  // the whole write is queued at once, so the receive buffer has to hold it
+  server.setsockopt(SOL_SOCKET, SO_RCVBUF, 1 << 20);
+  server.bind(new SockAddr({ ip: '127.0.0.1', port }));
+  server.resume();
+
+  // more packets than the submission queue has entries
+  const count = 300;
+  const seen = new Set();
+  const received = new Promise(resolve => {
+    server.on('data', buf => {
+      seen.add(buf.readUInt16BE(0));
+      if (seen.size == count) resolve();
+    });
+  });
+
+  const target = new SockAddr({ ip: '127.0.0.1', port });
+  const packets = [];
+  for (let i = 0; i < count; ++i) {
+    const buf = Buffer.alloc(2);
+    buf.writeUInt16BE(i);
+    packets.push([buf, target]);
+  }
+  const drained = once(client, 'drain');
+  client.write(packets);
+
+  await drained;
+  await received;
+  assert.equal(client.queueStats.packets, 0);
+  assert.equal(client.queueStats.bytes, 0);
+
+  client.close();
+  server.close();
+});
+
+test('Socket attachFilter', async (t) => {
+  if (os.platform() != 'linux') return;
+
+  // the filter sees the IP header on a raw socket only, UDP sockets start at the UDP header
+  let sniffer;
+  try {
+    sniffer = new Socket({ domain: AF_INET, type: SOCK_RAW, protocol: IPPROTO_UDP });
+  } catch (err) {
+    return t.skip(`no raw sockets: ${err.message}`);
+  }
+
+  const port = basePort + 3;
+  const other = basePort + 4;
+  sniffer.attachFilter(new BpfFilter(`udp port ${port}`, LinkLayerType.LINKTYPE_DLT_RAW1));
+  sniffer.resume();
+
+  const received = once(sniffer, 'data');
+  const client = udpSocket();
+  // loopback keeps the order, had the first one passed it would be seen first
+  client.write([
+    [Buffer.from('dropped'), new SockAddr({ ip: '127.0.0.1', port: other })],
+    [Buffer.from('passed'), new SockAddr({ ip: '127.0.0.1', port })],
+  ]);
+
+  const [buf] = await received;
+  const udp = (buf[0] & 0x0f) * 4;
+  assert.equal(buf.readUInt16BE(udp + 2), port);
+  assert.equal(buf.subarray(udp + 8).toString(), 'passed');
+
+  client.close();
+  sniffer.close();
+});
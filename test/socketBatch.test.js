@@ -0,0 +1,64 @@
+const { strict: assert } = require('node:assert');
+const test = require('node:test');
+
+const { SocketBatch, segments } = require('#lib/socketBatch');
+
+const entry = (family, port, ip) => {
+  const buf = Buffer.alloc(24);
+  buf.writeUInt16BE(family, 0);
+  buf.writeUInt16BE(port, 2);
+  buf[4] = ip.length;
+  Buffer.from(ip).copy(buf, 8);
+  return buf;
+};
+
+test('SocketBatch', async (t) => {
+  const fst = Buffer.from('hello');
+  const snd = Buffer.from('world!');
+  const thd = Buffer.from('');
+
+  const buffer = Buffer.concat([fst, snd, thd]);
+  const meta = new Uint32Array([
+    0, fst.length, 0, 0,
+    fst.length, snd.length, 1, 2,
+    fst.length + snd.length, 0, 0, 0,
+  ]);
+  const v6 = [0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1];
+  const addrs = Buffer.concat([entry(2, 5353, [192, 168, 1, 101]), entry(10, 53, v6)]);
+
+  const batch = new SocketBatch(buffer, meta, addrs);
+
+  assert.equal(batch.length, 3);
+  assert.deepEqual(batch.buffer(0), fst);
+  assert.deepEqual(batch.buffer(1), snd);
+  assert.equal(batch.buffer(2).length, 0);
+
+  assert.deepEqual(batch.address(0), { family: 2, port: 5353, ip: '192.168.1.101' });
+  assert.deepEqual(batch.address(1), { family: 10, port: 53, ip: '2001:db8::1' });
+  assert.equal(batch.address(2), batch.address(0));
+
+  assert.equal(batch.segmentSize(0), 0);
+  assert.equal(batch.segmentSize(1), 2);
+  assert.deepEqual(batch.segments(1).map(String), ['wo', 'rl', 'd!']);
+
+  const pairs = [...batch];
+  assert.equal(pairs.length, 3);
+  assert.deepEqual(pairs[1][0], snd);
+  assert.equal(pairs[1][1].ip, '2001:db8::1');
+  assert.equal(pairs[1][2], 2);
+});
+
+test('segments', async (t) => {
+  const buf = Buffer.from('abcdefg');
+  assert.deepEqual(segments(buf, 0), [buf]);
+  assert.deepEqual(segments(buf, 3).map(String), ['abc', 'def', 'g']);
+});
+
+test('SocketBatch on a connected socket', async (t) => {
+  const buffer = Buffer.from('abc');
+  const meta = new Uint32Array([0, 3, 0xffffffff, 0]);
+  const batch = new SocketBatch(buffer, meta, Buffer.alloc(0));
+
+  assert.equal(batch.address(0), undefined);
+  assert.deepEqual(batch.buffer(0), buffer);
+});
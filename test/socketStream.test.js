@@ -0,0 +1,100 @@
+const { strict: assert } = require('node:assert');
+const { EventEmitter, once } = require('node:events');
+const test = require('node:test');
+
+const { SocketStream } = require('#lib/socketStream');
+
+// stands in for a socket with a send queue of `limit` packets
+class FakeSocket extends EventEmitter {
+  constructor(limit = 0) {
+    super();
+    this.limit = limit;
+    this.queue = [];
+    this.sent = [];
+    this.paused = false;
+    this.closed = false;
+  }
+
+  get queueStats() {
+    return { packets: this.queue.length };
+  }
+
+  write(packets) {
+    // like the native one, what got queued is sent even if write() throws
+    if (this.queue.length == 0) {
+      setImmediate(() => {
+        this.sent.push(...this.queue);
+        this.queue = [];
+        this.emit('drain');
+      });
+    }
+    for (let i = 0; i < packets.length; ++i) {
+      if (this.limit > 0 && this.queue.length >= this.limit) {
+        const err = new Error('Send queue is full');
+        err.code = 'ENOBUFS';
+        err.queued = i;
+        throw err;
+      }
+      this.queue.push(packets[i]);
+    }
+    return this.limit == 0 || this.queue.length < this.limit;
+  }
+
+  pause() { this.paused = true; }
+  resume() { this.paused = false; }
+  close() { this.closed = true; }
+}
+
+test('SocketStream', async (t) => {
+  await t.test('writes in order under the queue limit', async () => {
+    const socket = new FakeSocket(3);
+    const stream = new SocketStream(socket);
+    const addr = { port: 1 };
+
+    for (let i = 0; i < 10; ++i) {
+      stream.write(i % 2 ? { data: Buffer.from([i]), address: addr } : [Buffer.from([i]), addr, 2]);
+    }
+    stream.end();
+    await once(stream, 'finish');
+
+    assert.deepEqual(socket.sent.map(([data]) => data[0]), [...Array(10).keys()]);
+    assert.equal(socket.sent[0][2], 2);
+    assert.equal(socket.sent[1].length, 2);
+  });
+
+  await t.test('fails on a packet over the limits', async () => {
+    const socket = new FakeSocket(1);
+    socket.write = () => {
+      const err = new Error('Send queue is full');
+      err.code = 'ENOBUFS';
+      err.queued = 0;
+      throw err;
+    };
+    const stream = new SocketStream(socket);
+    stream.on('error', () => {});
+    stream.write({ data: Buffer.alloc(1) });
+    const [err] = await once(stream, 'error');
+    assert.equal(err.code, 'ENOBUFS');
+    assert.ok(socket.closed);
+  });
+
+  await t.test('reads with backpressure', async () => {
+    const socket = new FakeSocket();
+    const stream = new SocketStream(socket, { highWaterMark: 2 });
+
+    socket.emit('data', Buffer.from('a'), { port: 1 });
+    socket.emit('data', Buffer.from('b'), { port: 2 }, 1);
+    assert.ok(socket.paused);
+
+    assert.deepEqual(stream.read(), { data: Buffer.from('a'), address: { port: 1 } });
+    assert.deepEqual(stream.read(), { data: Buffer.from('b'), address: { port: 2 }, segmentSize: 1 });
+    stream.read();
+    assert.ok(!socket.paused);
+
+    socket.emit('batch', [[Buffer.from('c'), { port: 3 }, 0]]);
+    assert.deepEqual(stream.read(), { data: Buffer.from('c'), address: { port: 3 } });
+
+    stream.destroy();
+    assert.ok(socket.closed);
+  });
+});